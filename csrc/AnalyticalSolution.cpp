@@ -1,240 +1,1106 @@
 #include "AnalyticalSolution.h"
 
+#include <pthread.h>
+#include <algorithm>
+
 AnalyticalSolution::AnalyticalSolution(
 	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
-	const double **conductivity, const double *capacitance) :
+	const double **conductivity, const double *capacitance,
+	size_t _thread_count, const reduction_t &reduction) :
+
+	model(new ThermalModel(_processor_count, _node_count,
+		_sampling_interval, _ambient_temperature, conductivity, capacitance,
+		_thread_count, reduction)),
 
 	processor_count(_processor_count),
 	node_count(_node_count),
+	state_count(model->state_count),
 	sampling_interval(_sampling_interval),
-	ambient_temperature(_ambient_temperature)
+	ambient_temperature(_ambient_temperature),
+	thread_count(_thread_count),
+
+	sinvC(model->sinvC), KT(model->KT), GT(model->GT),
+	L(model->L), U(model->U), UT(model->UT),
+	E(model->E), H(model->H), HT(model->HT), W(model->W)
 {
-	size_t i, j;
+#ifdef MEASURE_TIME
+	decomposition_time = model->decomposition_time;
+#endif
+}
 
-	K.resize(node_count, node_count);
-	sinvC.resize(node_count);
+AnalyticalSolution::~AnalyticalSolution()
+{
+	delete model;
+}
 
-	L.resize(node_count);
-	U.resize(node_count, node_count);
-	UT.resize(node_count, node_count);
+void AnalyticalSolution::accumulate(const double *power, size_t first,
+	size_t last, double *P) const
+{
+	vector_t Q(state_count), Z(state_count);
 
-	G.resize(node_count, node_count);
+	for (size_t i = first; i < last; i++) {
+		/* Q(i) = G * B(i) */
+		multiply_transposed_matrix_vector(GT, power + i * processor_count, Q);
+		/* P(i) = K * P(i-1) + Q(i) */
+		multiply_transposed_matrix_vector_plus_vector(KT, P, Q, Z);
+		__MEMCPY(P, Z, state_count);
+	}
+}
 
-	m_temp.resize(node_count, node_count);
-	v_temp.resize(node_count);
+void AnalyticalSolution::propagate(const double *power, size_t first,
+	size_t last, double *Y, double *temperature) const
+{
+	size_t i;
 
-	/* We have:
-	 * C * dT/dt = A * T + B
+	vector_t Q(state_count), Z(state_count);
+
+	for (i = first; i < last; i++) {
+		/* Return back to T from Y:
+		 * T = C^(-1/2) * Y
+		 *
+		 * And do not forget about the ambient temperature.
+		 */
+		observe(Y, temperature + i * processor_count);
+
+		/* Q(i) = G * B(i) */
+		multiply_transposed_matrix_vector(GT, power + i * processor_count, Q);
+		/* Y(i+1) = K * Y(i) + Q(i) */
+		multiply_transposed_matrix_vector_plus_vector(KT, Y, Q, Z);
+		__MEMCPY(Y, Z, state_count);
+	}
+}
+
+void AnalyticalSolution::superpose(const double *power,
+	double *temperature, size_t step_count, const double *M,
+	SolverWorkspace &w) const
+{
+	size_t i, j, k, l;
+
+	vector_t &Z = w.Z;
+	vector_t &EZ = w.S;
+
+	Z.resize(state_count);
+	EZ.resize(state_count);
+
+	/* Z = sum E^(m - 1 - i) * H * B(i) */
+	multiply_transposed_matrix_vector(HT, power, Z);
+
+	for (i = 1; i < step_count; i++) {
+		for (j = 0; j < state_count; j++) EZ[j] = E[j] * Z[j];
+		multiply_transposed_matrix_vector_plus_vector(HT,
+			power + i * processor_count, EZ, Z);
+	}
+
+	/* Z(0) = M * Z */
+	for (j = 0; j < state_count; j++)
+		Z[j] = M[j] * Z[j];
+
+	/* The projection T(i) = T(i) + W * Z(i) is done for several steps
+	 * at once as a matrix product, the steps go along the rows.
 	 */
-	matrix_t &A = K;
+	const size_t chunk_length = std::min(step_count, (size_t)UPDATE_CHUNK_LENGTH);
 
-	for (i = 0; i < node_count; i++) {
-		for (j = 0; j < node_count; j++)
-			A[i][j] = -conductivity[i][j];
-		sinvC[i] = sqrt(1.0 / capacitance[i]);
+	matrix_t &ZT = w.ZT;
+	matrix_t &TT = w.TT;
+
+	ZT.resize(state_count, chunk_length);
+	TT.resize(processor_count, chunk_length);
+
+	for (i = 0, k = 0; i < step_count; i++) {
+		for (j = 0; j < state_count; j++) ZT[j][k] = Z[j];
+
+		if (++k == chunk_length || i + 1 == step_count) {
+			double *_T = temperature + (i + 1 - k) * processor_count;
+
+			multiply_matrix_matrix_plus_matrix(processor_count, chunk_length,
+				state_count, W, ZT, NULL, TT);
+
+			for (l = 0; l < k; l++)
+				for (j = 0; j < processor_count; j++)
+					_T[l * processor_count + j] += TT[j][l];
+
+			k = 0;
+		}
+
+		/* Z(i+1) = E * Z(i) + H * B(i) */
+		for (j = 0; j < state_count; j++) EZ[j] = E[j] * Z[j];
+		multiply_transposed_matrix_vector_plus_vector(HT,
+			power + i * processor_count, EZ, Z);
+	}
+}
+
+void AnalyticalSolution::solve_condensed(const double *power,
+	double *temperature, size_t step_count, const matrix_t &R,
+	SolverWorkspace &w) const
+{
+	if (thread_count > 1) {
+		solve_parallel(power, temperature, step_count, R);
+		return;
+	}
+
+	vector_t &P = w.S;
+	vector_t &Y = w.Z;
+
+	P.resize(state_count);
+	Y.resize(state_count);
+
+	/* P(0) = Q(0) = G * B(0) */
+	multiply_transposed_matrix_vector(GT, power, P);
+
+	/* P(i) = K * P(i-1) + Q(i) */
+	accumulate(power, 1, step_count, P);
+
+	/* Y(0) = R * P(m-1) */
+	multiply_matrix_vector(R, P, Y);
+
+	/* Y(i+1) = K * Y(i) + Q(i) */
+	propagate(power, 0, step_count, Y, temperature);
+}
+
+struct AnalyticalSolution::chunk_t
+{
+	const AnalyticalSolution *solution;
+
+	/* The steps [first, last) */
+	size_t first;
+	size_t last;
+
+	const double *power;
+	double *temperature;
+
+	/* The local part of P(m-1) or Y at the first step */
+	double *Z;
+
+	bool fill;
+};
+
+void *AnalyticalSolution::solve_chunk(void *argument)
+{
+	const chunk_t &chunk = *(const chunk_t *)argument;
+
+	if (!chunk.fill) {
+		/* S = sum K^(last - 1 - i) * Q(i) */
+		__NULLIFY(chunk.Z, chunk.solution->state_count);
+		chunk.solution->accumulate(chunk.power, chunk.first, chunk.last,
+			chunk.Z);
+	}
+	else chunk.solution->propagate(chunk.power, chunk.first, chunk.last,
+		chunk.Z, chunk.temperature);
+
+	return NULL;
+}
+
+void AnalyticalSolution::solve_chunks(std::vector<chunk_t> &chunks)
+{
+	size_t i, count = chunks.size();
+
+	std::vector<pthread_t> threads(count);
+	std::vector<bool> started(count, false);
+
+	/* The chunks are independent, the ones without a thread are
+	 * done here.
+	 */
+	for (i = 1; i < count; i++)
+		started[i] = !pthread_create(&threads[i], NULL, solve_chunk, &chunks[i]);
+
+	solve_chunk(&chunks[0]);
+
+	for (i = 1; i < count; i++)
+		if (!started[i]) solve_chunk(&chunks[i]);
+
+	for (i = 1; i < count; i++)
+		if (started[i]) pthread_join(threads[i], NULL);
+}
+
+void AnalyticalSolution::solve_parallel(const double *power,
+	double *temperature, size_t step_count, const matrix_t &R) const
+{
+	size_t i, j, length;
+
+	const size_t chunk_count = std::min(thread_count, step_count);
+	const size_t chunk_length = (step_count + chunk_count - 1) / chunk_count;
+
+	std::vector<chunk_t> chunks;
+
+	matrix_t S(chunk_count, state_count);
+
+	for (i = 0; i * chunk_length < step_count; i++) {
+		chunk_t chunk;
+
+		chunk.solution = this;
+		chunk.first = i * chunk_length;
+		chunk.last = std::min(step_count, chunk.first + chunk_length);
+		chunk.power = power;
+		chunk.temperature = temperature;
+		chunk.Z = S[i];
+		chunk.fill = false;
+
+		chunks.push_back(chunk);
+	}
+
+	const size_t count = chunks.size();
+
+	solve_chunks(chunks);
+
+	/* K^(chunk length) = U * diag(exp(length * t * l0), ...) * UT */
+	matrix_t KL(state_count, state_count), UE(state_count, state_count);
+	vector_t P(state_count, 0), Z(state_count), EL(state_count);
+
+	for (i = 0, length = 0; i < count; i++) {
+		if (length != chunks[i].last - chunks[i].first) {
+			length = chunks[i].last - chunks[i].first;
+			for (j = 0; j < state_count; j++)
+				EL[j] = exp(sampling_interval * length * L[j]);
+			multiply_matrix_diagonal_matrix(U, EL, UE);
+			multiply_matrix_matrix(UE, UT, KL);
+		}
+
+		/* P(last - 1) = K^length * P(first - 1) + S */
+		multiply_matrix_vector_plus_vector(KL, P, S[i], Z);
+		__MEMCPY(P, Z, state_count);
+	}
+
+	matrix_t Y(count, state_count);
+
+	/* Y(0) = R * P(m-1) */
+	multiply_matrix_vector(R, P, Y[0]);
+
+	for (i = 1, length = 0; i < count; i++) {
+		if (length != chunks[i - 1].last - chunks[i - 1].first) {
+			length = chunks[i - 1].last - chunks[i - 1].first;
+			for (j = 0; j < state_count; j++)
+				EL[j] = exp(sampling_interval * length * L[j]);
+			multiply_matrix_diagonal_matrix(U, EL, UE);
+			multiply_matrix_matrix(UE, UT, KL);
+		}
+
+		/* Y(first) = K^length * Y(previous first) + S(previous) */
+		multiply_matrix_vector_plus_vector(KL, Y[i - 1], S[i - 1], Y[i]);
+	}
+
+	for (i = 0; i < count; i++) {
+		chunks[i].Z = Y[i];
+		chunks[i].fill = true;
+	}
+
+	solve_chunks(chunks);
+}
+
+void AnalyticalSolution::solve_segments(const PowerSegments &segments,
+	const double *M, const std::vector<size_t> *steps, double *temperature,
+	double *average) const
+{
+	size_t i, j, k, l, length, start, step;
+
+	const size_t segment_count = segments.size();
+	const size_t sample_count = steps ? steps->size() : 0;
+
+	/* For a segment of k steps with constant power B:
+	 * Z(k) = exp(L * k * t) * Z(0) + S(k) * H * B
+	 * S(k) = (1 - exp(L * k * t)) / (1 - exp(L * t))
+	 */
+	matrix_t Q(segment_count, state_count);
+	matrix_t Ek(segment_count, state_count);
+	matrix_t Sk(segment_count, state_count);
+
+	vector_t Z(state_count, 0), Zk(state_count);
+
+	/* P(m-1) = sum K^(m-1-i) * Q(i) in the eigenbasis */
+	for (i = 0; i < segment_count; i++) {
+		length = segments.lengths[i];
+
+		multiply_matrix_incomplete_vector(H, segments.power[i],
+			processor_count, Q[i]);
+
+		for (j = 0; j < state_count; j++) {
+			Ek[i][j] = exp(sampling_interval * length * L[j]);
+			Sk[i][j] = (1 - Ek[i][j]) / (1 - E[j]);
+			Z[j] = Ek[i][j] * Z[j] + Sk[i][j] * Q[i][j];
+		}
+	}
+
+	/* Z(0) = M * P(m-1) */
+	for (j = 0; j < state_count; j++) Z[j] = M[j] * Z[j];
+
+	for (i = 0, l = 0, start = 0; i < segment_count; i++) {
+		length = segments.lengths[i];
+
+		if (!steps)
+			multiply_matrix_vector_plus_scalar(W, Z, ambient_temperature,
+				temperature + i * processor_count);
+		else
+			for (; l < sample_count && (step = (*steps)[l]) < start + length; l++) {
+				k = step - start;
+
+				/* Z(k) = exp(L * k * t) * Z(0) + S(k) * Q */
+				for (j = 0; j < state_count; j++) {
+					Zk[j] = exp(sampling_interval * k * L[j]);
+					Zk[j] = Zk[j] * Z[j] + (1 - Zk[j]) / (1 - E[j]) * Q[i][j];
+				}
+
+				multiply_matrix_vector_plus_scalar(W, Zk, ambient_temperature,
+					temperature + l * processor_count);
+			}
+
+		if (average) {
+			/* Mean of Z(0), ..., Z(k-1):
+			 * (S(k) * Z(0) + (k - S(k)) / (1 - exp(L * t)) * Q) / k
+			 */
+			for (j = 0; j < state_count; j++)
+				Zk[j] = (Sk[i][j] * Z[j] +
+					(length - Sk[i][j]) / (1 - E[j]) * Q[i][j]) / length;
+
+			multiply_matrix_vector_plus_scalar(W, Zk, ambient_temperature,
+				average + i * processor_count);
+		}
+
+		for (j = 0; j < state_count; j++)
+			Z[j] = Ek[i][j] * Z[j] + Sk[i][j] * Q[i][j];
+
+		start += length;
+	}
+}
+
+void AnalyticalSolution::calculate_M(size_t step_count, vector_t &M) const
+{
+	double total_time = sampling_interval * step_count;
+
+	M.resize(state_count);
+
+	/* M = diag(1/(1 - exp(Tau * l0)), ...) */
+	for (size_t i = 0; i < state_count; i++)
+		M[i] = 1.0 / (1.0 - exp(total_time * L[i]));
+}
+
+/******************************************************************************/
+
+CondensedEquation::CondensedEquation(size_t _processor_count, size_t _node_count,
+	double _sampling_interval, double _ambient_temperature,
+	const double **conductivity, const double *capacitance,
+	size_t _thread_count, const reduction_t &reduction) :
+
+	AnalyticalSolution(_processor_count, _node_count, _sampling_interval,
+		_ambient_temperature, conductivity, capacitance, _thread_count,
+		reduction)
+{
+}
+
+void CondensedEquation::solve(const double *power, double *temperature,
+	size_t step_count, SolverWorkspace &w) const
+{
+	solve_condensed(power, temperature, step_count,
+		calculate_R(step_count, w), w);
+}
+
+void CondensedEquation::solve(const PowerSegments &segments,
+	double *temperature) const
+{
+	vector_t M;
+	calculate_M(segments.steps(), M);
+	solve_segments(segments, M, NULL, temperature);
+}
+
+void CondensedEquation::solve(const PowerSegments &segments,
+	const std::vector<size_t> &steps, double *temperature) const
+{
+	vector_t M;
+	calculate_M(segments.steps(), M);
+	solve_segments(segments, M, &steps, temperature);
+}
+
+void CondensedEquation::solve(const std::vector<const double *> &power,
+	const std::vector<double *> &temperature, size_t step_count,
+	SolverWorkspace &w) const
+{
+	size_t i, b;
+
+	const size_t count = power.size();
+
+	w.X.resize(step_count * count, processor_count);
+
+	for (i = 0; i < step_count; i++)
+		for (b = 0; b < count; b++)
+			__MEMCPY(w.X[i * count + b], power[b] + i * processor_count,
+				processor_count);
+
+	solve_stack(step_count, count, w);
+
+	/* T = C^(-1/2) * Y + T_amb */
+	for (b = 0; b < count; b++)
+		for (i = 0; i < step_count; i++)
+			observe(w.Y[i * count + b], temperature[b] + i * processor_count);
+}
+
+void CondensedEquation::solve_steady(const double *power,
+	double *temperature) const
+{
+	vector_t Z(state_count);
+
+	/* Z = E * Z + H * B, hence, Z = H * B / (1 - E) */
+	multiply_transposed_matrix_vector(HT, power, Z);
+
+	for (size_t i = 0; i < state_count; i++)
+		Z[i] = Z[i] / (1 - E[i]);
+
+	/* T = W * Z + T_amb */
+	multiply_matrix_vector_plus_scalar(W, Z, ambient_temperature, temperature);
+}
+
+void CondensedEquation::solve_stack(size_t step_count, size_t count,
+	SolverWorkspace &w) const
+{
+	size_t i;
+
+	const size_t size = count * state_count;
+
+	matrix_t &X = w.X;
+	matrix_t &P = w.P;
+	matrix_t &Q = w.Q;
+	matrix_t &Y = w.Y;
+	matrix_t &m_temp = w.m_temp;
+
+	P.resize(step_count * count, state_count);
+	Q.resize(step_count * count, state_count);
+	Y.resize(step_count * count, state_count);
+
+	/* The same recurrences as for one profile, but each step is
+	 * a (count x state_count) block, and the vectors are its rows:
+	 * Q(i) = B(i) * GT, P(i) = P(i-1) * KT + Q(i), etc.
+	 */
+	multiply_matrix_matrix_plus_matrix(step_count * count, state_count,
+		processor_count, X, GT, NULL, Q);
+
+	/* P(0) = Q(0) */
+	__MEMCPY(P, Q, size);
+
+	for (i = 1; i < step_count; i++)
+		multiply_matrix_matrix_plus_matrix(count, state_count, state_count,
+			P[(i - 1) * count], KT, Q[i * count], P[i * count]);
+
+	/* Y(0) = P(m-1) * RT */
+	m_temp.resize(state_count, state_count);
+	transpose_matrix(calculate_R(step_count, w), m_temp);
+
+	multiply_matrix_matrix_plus_matrix(count, state_count, state_count,
+		P[(step_count - 1) * count], m_temp, NULL, Y);
+
+	/* Y(i+1) = Y(i) * KT + Q(i) */
+	for (i = 1; i < step_count; i++)
+		multiply_matrix_matrix_plus_matrix(count, state_count, state_count,
+			Y[(i - 1) * count], KT, Q[(i - 1) * count], Y[i * count]);
+}
+
+const matrix_t &CondensedEquation::calculate_R(size_t step_count,
+	SolverWorkspace &w) const
+{
+	typedef SolverWorkspace::operator_t operator_t;
+
+	std::list<operator_t> &operators = w.operators;
+	std::list<operator_t>::iterator it;
+
+	/* The operators of another model are of no use */
+	if (w.model != model) {
+		operators.clear();
+		w.model = model;
+	}
+
+	for (it = operators.begin(); it != operators.end(); it++)
+		if (it->first == step_count) {
+			/* Move to the front as the most recently used */
+			if (it != operators.begin())
+				operators.splice(operators.begin(), operators, it);
+			return operators.front().second;
+		}
+
+	if (operators.size() >= MAX_CACHED_OPERATORS) {
+		/* Reuse the least recently used one */
+		operators.splice(operators.begin(), operators, --operators.end());
+	}
+	else operators.push_front(operator_t(0, matrix_t(state_count, state_count)));
+
+	operator_t &entry = operators.front();
+	entry.first = step_count;
+
+	/* R = U * M * UT */
+	calculate_M(step_count, w.v_temp);
+	w.m_temp.resize(state_count, state_count);
+	multiply_matrix_diagonal_matrix(U, w.v_temp, w.m_temp);
+	multiply_matrix_matrix(w.m_temp, UT, entry.second);
+
+	return entry.second;
+}
+
+/******************************************************************************/
+
+LeakageCondensedEquation::LeakageCondensedEquation(
+	size_t _processor_count, size_t _node_count,
+	double _sampling_interval, double _ambient_temperature,
+	double **conductivity, const double *capacitance,
+	const Leakage &_leakage, size_t _history,
+	const reduction_t &reduction) :
+
+	CondensedEquation(_processor_count, _node_count, _sampling_interval,
+		_ambient_temperature,
+		(const double **)_leakage.setup(conductivity, _ambient_temperature),
+		capacitance, 1, reduction), leakage(_leakage), history(_history)
+{
+}
+
+size_t LeakageCondensedEquation::solve(const double *dynamic_power,
+	double *temperature, double *total_power, size_t step_count,
+	SolverWorkspace &w) const
+{
+	const matrix_t &R = calculate_R(step_count, w);
+
+	size_t i, count, it;
+	double error, max_error;
+
+	const size_t max_iterations = leakage.get_max_iterations();
+	const double tolerance = leakage.get_tolerance();
+
+	/* Nothing to reuse with a single iteration */
+	if (max_iterations <= 1) {
+		leakage.inject(ambient_temperature, dynamic_power, total_power, step_count);
+		solve_condensed(total_power, temperature, step_count, R, w);
+		leakage.finalize(temperature, dynamic_power, total_power, step_count);
+		return 1;
+	}
+
+	vector_t M;
+	calculate_M(step_count, M);
+
+	w.T.resize(step_count, processor_count);
+	w.dynamic_temperature.resize(step_count, processor_count);
+	w.leakage_power.resize(step_count, processor_count);
+
+	double *_T = w.T;
+	double *_D = w.dynamic_temperature;
+	double *_B = w.leakage_power;
+	count = step_count * processor_count;
+
+	AndersonMixing &mixing = w.get_mixing(history);
+
+	/* The response to the dynamic power, including the ambient temperature */
+	solve_condensed(dynamic_power, _D, step_count, R, w);
+
+	/* The first guess is the ambient temperature */
+	for (i = 0; i < count; i++) temperature[i] = ambient_temperature;
+	mixing.reset(count);
+
+	leakage.inject(ambient_temperature, dynamic_power, total_power, step_count);
+
+	/* We come to the iterative part */
+	for (it = 1;; it++) {
+		for (i = 0; i < count; i++)
+			_B[i] = total_power[i] - dynamic_power[i];
+
+		if (it < max_iterations) {
+			__MEMCPY(_T, _D, count);
+			superpose(_B, _T, step_count, M, w);
+
+			/* There is a reason to check the error.
+			 */
+			max_error = 0;
+			for (i = 0; i < count; i++) {
+				error = std::abs(temperature[i] - _T[i]);
+				if (max_error < error) max_error = error;
+			}
+
+			/* Still have some iterations left,
+			 * the only question is the error.
+			 */
+			if (max_error < tolerance) {
+				__MEMCPY(temperature, _T, count);
+				break;
+			}
+
+			/* Without acceleration, the next guess is just _T */
+			mixing.next(temperature, _T);
+		}
+		else {
+			__MEMCPY(temperature, _D, count);
+			superpose(_B, temperature, step_count, M, w);
+
+			/* Limit of iterations is reached,
+			 * quite right now.
+			 */
+			break;
+		}
+
+		leakage.inject(temperature, dynamic_power, total_power, step_count);
+	}
+
+	leakage.finalize(temperature, dynamic_power, total_power, step_count);
+
+	return it;
+}
+
+size_t LeakageCondensedEquation::solve(const PowerSegments &dynamic_power,
+	double *temperature, double *total_power) const
+{
+	size_t i, it;
+	double error, max_error;
+
+	const size_t segment_count = dynamic_power.size();
+	const size_t count = segment_count * processor_count;
+
+	vector_t M;
+	calculate_M(dynamic_power.steps(), M);
+
+	/* The total power has the same segments as the dynamic one,
+	 * and the leakage is injected according to the average
+	 * temperature of each segment.
+	 */
+	PowerSegments segments;
+	segments.lengths = dynamic_power.lengths;
+	segments.power.resize(segment_count, processor_count);
+
+	matrix_t average(segment_count, processor_count);
+	matrix_t last_average(segment_count, processor_count);
+
+	const size_t max_iterations = leakage.get_max_iterations();
+	const double tolerance = leakage.get_tolerance();
+
+	leakage.inject(ambient_temperature, dynamic_power.power,
+		segments.power, segment_count);
+
+	for (it = 1;; it++) {
+		solve_segments(segments, M, NULL, temperature, average);
+
+		if (it >= max_iterations) break;
+
+		max_error = 0;
+		for (i = 0; i < count; i++) {
+			error = std::abs(last_average.pointer()[i] - average.pointer()[i]);
+			if (max_error < error) max_error = error;
+		}
+
+		if (it > 1 && max_error < tolerance) break;
+
+		last_average = average;
+
+		leakage.inject(average, dynamic_power.power,
+			segments.power, segment_count);
+	}
+
+	leakage.finalize(average, dynamic_power.power,
+		segments.power, segment_count);
+
+	__MEMCPY(total_power, segments.power, count);
+
+	return it;
+}
+
+size_t LeakageCondensedEquation::solve(
+	const std::vector<const double *> &dynamic_power,
+	const std::vector<double *> &temperature,
+	const std::vector<double *> &total_power, size_t step_count,
+	SolverWorkspace &w) const
+{
+	size_t i, k, l, b, r, it;
+	double error, max_error;
+
+	const size_t count = dynamic_power.size();
+
+	const size_t max_iterations = leakage.get_max_iterations();
+	const double tolerance = leakage.get_tolerance();
+
+	const size_t size = step_count * processor_count;
+
+	/* With a single iteration, the total power is solved for directly,
+	 * otherwise, the response to the dynamic power is found for
+	 * the whole batch at once, and the leakage is superposed
+	 * profile by profile.
+	 */
+	const bool single = max_iterations <= 1;
+
+	for (b = 0; b < count; b++)
+		leakage.inject(ambient_temperature, dynamic_power[b],
+			total_power[b], step_count);
+
+	matrix_t &X = w.X;
+	matrix_t &Y = w.Y;
+	matrix_t &dynamic_temperature = w.dynamic_temperature;
+	std::vector<AndersonMixing> &mixings = w.mixings;
+
+	X.resize(step_count * count, processor_count);
+
+	for (i = 0; i < step_count; i++)
+		for (b = 0; b < count; b++)
+			__MEMCPY(X[i * count + b], single ? total_power[b] +
+				i * processor_count : dynamic_power[b] + i * processor_count,
+				processor_count);
+
+	solve_stack(step_count, count, w);
+
+	if (single) {
+		for (b = 0; b < count; b++) {
+			for (i = 0; i < step_count; i++)
+				observe(Y[i * count + b], temperature[b] + i * processor_count);
+
+			leakage.finalize(temperature[b], dynamic_power[b],
+				total_power[b], step_count);
+		}
+
+		return 1;
+	}
+
+	dynamic_temperature.resize(count * step_count, processor_count);
+
+	for (b = 0; b < count; b++)
+		for (i = 0; i < step_count; i++)
+			observe(Y[i * count + b], dynamic_temperature[b * step_count + i]);
+
+	vector_t M;
+	calculate_M(step_count, M);
+
+	w.T.resize(step_count, processor_count);
+	w.leakage_power.resize(step_count, processor_count);
+
+	double *_T = w.T;
+	double *_B = w.leakage_power;
+
+	/* The profiles that have not converged yet */
+	std::vector<size_t> active(count);
+
+	if (!mixings.empty() && mixings[0].get_depth() != history)
+		mixings.clear();
+
+	mixings.resize(count, AndersonMixing(history));
+
+	for (b = 0; b < count; b++) {
+		active[b] = b;
+
+		/* The first guess is the ambient temperature */
+		for (i = 0; i < size; i++) temperature[b][i] = ambient_temperature;
+		mixings[b].reset(size);
+	}
+
+	for (it = 1;; it++) {
+		const size_t active_count = active.size();
+
+		for (r = 0, k = 0; r < active_count; r++) {
+			b = active[r];
+
+			for (l = 0; l < size; l++)
+				_B[l] = total_power[b][l] - dynamic_power[b][l];
+
+			__MEMCPY(_T, dynamic_temperature[b * step_count], size);
+			superpose(_B, _T, step_count, M, w);
+
+			max_error = 0;
+			for (l = 0; l < size; l++) {
+				error = std::abs(temperature[b][l] - _T[l]);
+				if (max_error < error) max_error = error;
+			}
+
+			/* Converged profiles leave the batch */
+			if (it >= max_iterations || max_error < tolerance) {
+				__MEMCPY(temperature[b], _T, size);
+				leakage.finalize(temperature[b], dynamic_power[b],
+					total_power[b], step_count);
+			}
+			else {
+				mixings[b].next(temperature[b], _T);
+				leakage.inject(temperature[b], dynamic_power[b],
+					total_power[b], step_count);
+				active[k++] = b;
+			}
+		}
+
+		if (k == 0) break;
+
+		active.resize(k);
+	}
+
+	return it;
+}
+
+/******************************************************************************/
+
+BandedCondensedEquation::BandedCondensedEquation(
+	size_t _processor_count, size_t _node_count,
+	double _sampling_interval, double _ambient_temperature,
+	const double **_conductivity, const double *_capacitance,
+	const BandedLinearLeakage &_leakage, const reduction_t &_reduction) :
+
+	processor_count(_processor_count), node_count(_node_count),
+	sampling_interval(_sampling_interval),
+	ambient_temperature(_ambient_temperature), leakage(_leakage),
+	reduction(_reduction), state_count(0), error_bound(0)
+{
+	conductivity.resize(node_count, node_count);
+	capacitance.resize(node_count);
+
+	for (size_t i = 0; i < node_count; i++)
+		__MEMCPY(conductivity[i], _conductivity[i], node_count);
+
+	__MEMCPY(capacitance, _capacitance, node_count);
+
+	/* Every solution starts from the bands of the ambient temperature */
+	get_model(std::vector<size_t>(processor_count,
+		leakage.select(ambient_temperature)));
+}
+
+BandedCondensedEquation::~BandedCondensedEquation()
+{
+	std::list<model_t>::iterator it;
+
+	for (it = models.begin(); it != models.end(); it++)
+		delete it->second;
+}
+
+size_t BandedCondensedEquation::solve(const double *dynamic_power,
+	double *temperature, double *total_power, size_t step_count)
+{
+	size_t i, j, k, count;
+
+	std::vector<size_t> bands(processor_count), next(processor_count);
+
+	vector_t power(processor_count), average_power(processor_count);
+	vector_t average(processor_count);
+
+	/* The average dynamic power */
+	for (j = 0; j < processor_count; j++) power[j] = 0;
+
+	for (i = 0, k = 0; i < step_count; i++)
+		for (j = 0; j < processor_count; j++, k++)
+			power[j] += dynamic_power[k];
+
+	for (j = 0; j < processor_count; j++) power[j] /= double(step_count);
+
+	/* From the ambient temperature up, the steady states are cheap
+	 * as long as the models are at hand.
+	 */
+	for (j = 0; j < processor_count; j++)
+		bands[j] = leakage.select(ambient_temperature);
+
+	for (i = 0; i < leakage.get_band_count(); i++) {
+		leakage.inject(&bands[0], ambient_temperature,
+			power, average_power, 1);
+
+		get_model(bands).solve_steady(average_power, average);
+
+		for (j = 0; j < processor_count; j++)
+			next[j] = leakage.select(average[j]);
+
+		if (next == bands) break;
+
+		bands = next;
+	}
+
+	/* The solution itself and at most one correction */
+	for (count = 1;; count++) {
+		leakage.inject(&bands[0], ambient_temperature,
+			dynamic_power, total_power, step_count);
+
+		get_model(bands).solve(total_power, temperature, step_count);
+
+		if (count > 1) break;
+
+		select(temperature, step_count, next);
+
+		if (next == bands) break;
+
+		bands = next;
+	}
+
+	leakage.finalize(&bands[0], temperature, dynamic_power,
+		total_power, step_count);
+
+	return count;
+}
+
+CondensedEquation &BandedCondensedEquation::get_model(
+	const std::vector<size_t> &bands)
+{
+	std::list<model_t>::iterator it;
+
+	for (it = models.begin(); it != models.end(); it++)
+		if (it->first == bands) {
+			/* Move to the front as the most recently used */
+			if (it != models.begin())
+				models.splice(models.begin(), models, it);
+			return *models.front().second;
+		}
+
+	if (models.size() >= MAX_CACHED_DECOMPOSITIONS) {
+		delete models.back().second;
+		models.pop_back();
 	}
 
-	matrix_t &D = A;
+	matrix_t folded(conductivity);
+	std::vector<double *> rows(node_count);
 
-	/* We want to get rid of everything in front of dX/dt,
-	 * but at the same time we want to keep the matrix in front of X
-	 * symmetric, so we do the following substitution:
-	 * Y = C^(1/2) * T
-	 * D = C^(-1/2) * A * C^(-1/2)
-	 * E = C^(-1/2) * B
-	 *
-	 * Eventually, we have:
-	 * dY/dt = DY + E
-	 */
-	multiply_diagonal_matrix_matrix(sinvC, A, m_temp);
-	multiply_matrix_diagonal_matrix(m_temp, sinvC, D);
+	for (size_t i = 0; i < node_count; i++) rows[i] = folded[i];
 
-#ifdef MEASURE_TIME
-	struct timespec begin, end;
-	Time::measure(&begin);
-#endif
+	leakage.fold(&rows[0], &bands[0]);
 
-	/* Eigenvalue decomposition:
-	 * D = U * L * UT
-	 *
-	 * Where:
-	 * L = diag(l0, ..., l(n-1))
-	 */
-	EigenvalueDecomposition S(D, U, L);
+	CondensedEquation *model = new CondensedEquation(
+		processor_count, node_count, sampling_interval, ambient_temperature,
+		(const double **)&rows[0], capacitance, 1, reduction);
 
-#ifdef MEASURE_TIME
-	Time::measure(&end);
-	decomposition_time = Time::substract(&end, &begin);
-#endif
+	models.push_front(model_t(bands, model));
 
-	transpose_matrix(U, UT);
+	state_count = std::max(state_count, model->get_state_count());
+	error_bound = std::max(error_bound, model->get_error_bound());
 
-	/* Matrix exponential:
-	 * K = exp(D * t) = U * exp(L * t) * UT
-	 */
-	for (i = 0; i < node_count; i++) v_temp[i] = exp(sampling_interval * L[i]);
-	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
-	multiply_matrix_matrix(m_temp, UT, K);
+	return *model;
+}
 
-	/* Coefficient matrix G:
-	 * G = D^(-1) * (exp(D * t) - I) * C^(-1/2) =
-	 * = U * diag((exp(t * l0) - 1) / l0, ...) * UT * C^(-1/2)
+void BandedCondensedEquation::select(const double *temperature,
+	size_t step_count, std::vector<size_t> &bands) const
+{
+	size_t i, j, k;
+
+	vector_t average(processor_count), peak(processor_count);
+
+	for (j = 0; j < processor_count; j++) {
+		average[j] = 0;
+		peak[j] = temperature[j];
+	}
+
+	for (i = 0, k = 0; i < step_count; i++)
+		for (j = 0; j < processor_count; j++, k++) {
+			average[j] += temperature[k];
+			if (peak[j] < temperature[k]) peak[j] = temperature[k];
+		}
+
+	/* The leakage is convex, hence, the hot part of the profile
+	 * weighs more than the average alone suggests.
 	 */
-	for (i = 0; i < node_count; i++) v_temp[i] = (v_temp[i] - 1) / L[i];
-	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
-	multiply_matrix_matrix_diagonal_matrix(m_temp, UT, sinvC, G);
+	for (j = 0; j < processor_count; j++) {
+		average[j] /= double(step_count);
+		bands[j] = leakage.select(average[j] + (peak[j] - average[j]) / 3);
+	}
 }
 
 /******************************************************************************/
 
-CondensedEquation::CondensedEquation(size_t _processor_count, size_t _node_count,
+ModalCondensedEquation::ModalCondensedEquation(
+	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
-	const double **conductivity, const double *capacitance) :
+	const double **conductivity, const double *capacitance,
+	const reduction_t &reduction) :
 
 	AnalyticalSolution(_processor_count, _node_count, _sampling_interval,
-		_ambient_temperature, conductivity, capacitance)
+		_ambient_temperature, conductivity, capacitance, 1, reduction)
 {
 }
 
-void CondensedEquation::solve(const double *power, double *temperature,
-	size_t step_count)
+void ModalCondensedEquation::solve(const double *power, double *temperature,
+	size_t step_count, SolverWorkspace &w) const
 {
-	size_t i, j, k;
+	size_t i, j;
 
-	P.resize(step_count, node_count);
-	Q.resize(step_count, node_count);
-	Y.resize(step_count, node_count);
+	matrix_t &Q = w.Q;
+	vector_t &Y = w.Z;
 
-	Q.nullify();
+	Q.resize(step_count, state_count);
+	Y.resize(state_count);
 
 	double total_time = sampling_interval * step_count;
 
-	/* M = diag(1/(1 - exp(Tau * l0)), ...) */
-	for (i = 0; i < node_count; i++)
-		v_temp[i] = 1.0 / (1.0 - exp(total_time * L[i]));
-
-	/* Q(0) = G * B(0) */
-	multiply_matrix_incomplete_vector(G, power, processor_count, Q[0]);
-	/* P(0) = Q(0) */
-	__MEMCPY(P[0], Q[0], node_count);
-
-	for (i = 1; i < step_count; i++) {
-		/* Q(i) = G * B(i) */
-		multiply_matrix_incomplete_vector(G, power + i * processor_count,
+	/* Q(i) = H * B(i) */
+	for (i = 0; i < step_count; i++)
+		multiply_matrix_incomplete_vector(H, power + i * processor_count,
 			processor_count, Q[i]);
-		/* P(i) = K * P(i-1) + Q(i) */
-		multiply_matrix_vector_plus_vector(K, P[i - 1], Q[i], P[i]);
-	}
 
-	/* Y(0) = U * M * UT * P(m-1), for M see above ^ */
-	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
-	multiply_matrix_matrix_vector(m_temp, UT, P[step_count - 1], Y[0]);
+	/* P(0) = Q(0), P(i) = E * P(i-1) + Q(i) */
+	__MEMCPY(Y, Q[0], state_count);
 
-	/* Y(i+1) = K * Y(i) + Q(i) */
 	for (i = 1; i < step_count; i++)
-		multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
+		for (j = 0; j < state_count; j++)
+			Y[j] = E[j] * Y[j] + Q[i][j];
 
-	/* Return back to T from Y:
-	 * T = C^(-1/2) * Y
+	/* Z(0) = M * P(m-1), M = diag(1/(1 - exp(Tau * l0)), ...) */
+	for (j = 0; j < state_count; j++)
+		Y[j] = Y[j] / (1.0 - exp(total_time * L[j]));
+
+	/* Return back to T from Z:
+	 * T = C^(-1/2) * U * Z = W * Z
 	 *
 	 * And do not forget about the ambient temperature.
 	 */
-	for (i = 0, k = 0; i < step_count; i++)
-		for (j = 0; j < processor_count; j++, k++)
-			temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
+	multiply_matrix_vector_plus_scalar(W, Y, ambient_temperature, temperature);
+
+	/* Z(i+1) = E * Z(i) + Q(i) */
+	for (i = 1; i < step_count; i++) {
+		for (j = 0; j < state_count; j++)
+			Y[j] = E[j] * Y[j] + Q[i - 1][j];
+
+		multiply_matrix_vector_plus_scalar(W, Y, ambient_temperature,
+			temperature + i * processor_count);
+	}
 }
 
 /******************************************************************************/
 
-LeakageCondensedEquation::LeakageCondensedEquation(
+LeakageModalCondensedEquation::LeakageModalCondensedEquation(
 	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
 	double **conductivity, const double *capacitance,
-	const Leakage &_leakage) :
+	const Leakage &_leakage, size_t _history,
+	const reduction_t &reduction) :
 
-	CondensedEquation(_processor_count, _node_count, _sampling_interval,
+	ModalCondensedEquation(_processor_count, _node_count, _sampling_interval,
 		_ambient_temperature,
 		(const double **)_leakage.setup(conductivity, _ambient_temperature),
-		capacitance), leakage(_leakage)
+		capacitance, reduction), leakage(_leakage), history(_history)
 {
 }
 
-size_t LeakageCondensedEquation::solve(const double *dynamic_power,
-	double *temperature, double *total_power, size_t step_count)
+size_t LeakageModalCondensedEquation::solve(const double *dynamic_power,
+	double *temperature, double *total_power, size_t step_count,
+	SolverWorkspace &w) const
 {
-	size_t i, j, k, it;
-	double tmp, error, max_error;
-
-	P.resize(step_count, node_count);
-	Q.resize(step_count, node_count);
-	Y.resize(step_count, node_count);
+	size_t i, count, it;
+	double error, max_error;
 
-	Q.nullify();
+	w.T.resize(step_count, processor_count);
 
-	double total_time = sampling_interval * step_count;
+	double *_T = w.T;
+	count = step_count * processor_count;
 
-	/* M = diag(1/(1 - exp(Tau * l0)), ...) */
-	for (i = 0; i < node_count; i++)
-		v_temp[i] = 1.0 / (1.0 - exp(total_time * L[i]));
+	AndersonMixing &mixing = w.get_mixing(history);
 
 	const size_t max_iterations = leakage.get_max_iterations();
 	const double tolerance = leakage.get_tolerance();
 
+	/* The first guess is the ambient temperature */
+	for (i = 0; i < count; i++) temperature[i] = ambient_temperature;
+	mixing.reset(count);
+
 	leakage.inject(ambient_temperature, dynamic_power, total_power, step_count);
 
 	/* We come to the iterative part */
 	for (it = 1;; it++) {
-		/* Q(0) = G * B(0) */
-		multiply_matrix_incomplete_vector(G, total_power, processor_count, Q[0]);
-		/* P(0) = Q(0) */
-		__MEMCPY(P[0], Q[0], node_count);
-
-		for (i = 1; i < step_count; i++) {
-			/* Q(i) = G * B(i) */
-			multiply_matrix_incomplete_vector(G, total_power + i * processor_count,
-				processor_count, Q[i]);
-			/* P(i) = K * P(i-1) + Q(i) */
-			multiply_matrix_vector_plus_vector(K, P[i - 1], Q[i], P[i]);
-		}
-
-		/* Y(0) = U * M * UT * P(m-1), for M see above ^ */
-		multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
-		multiply_matrix_matrix_vector(m_temp, UT, P[step_count - 1], Y[0]);
-
-		/* Y(i+1) = K * Y(i) + Q(i) */
-		for (i = 1; i < step_count; i++)
-			multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
-
-		/* Return back to T from Y:
-		 * T = C^(-1/2) * Y
-		 *
-		 * And do not forget about the ambient temperature. Also perform
-		 * the error control.
-		 */
 		if (it < max_iterations) {
+			ModalCondensedEquation::solve(total_power, _T, step_count, w);
+
 			/* There is a reason to check the error.
 			 */
 			max_error = 0;
-			for (i = 0, k = 0; i < step_count; i++)
-				for (j = 0; j < processor_count; j++, k++) {
-					tmp = Y[i][j] * sinvC[j] + ambient_temperature;
-
-					error = std::abs(temperature[k] - tmp);
-					if (max_error < error) max_error = error;
-
-					temperature[k] = tmp;
-				}
+			for (i = 0; i < count; i++) {
+				error = std::abs(temperature[i] - _T[i]);
+				if (max_error < error) max_error = error;
+			}
 
 			/* Still have some iterations left,
 			 * the only question is the error.
 			 */
-			if (max_error < tolerance) break;
+			if (max_error < tolerance) {
+				__MEMCPY(temperature, _T, count);
+				break;
+			}
+
+			/* Without acceleration, the next guess is just _T */
+			mixing.next(temperature, _T);
 		}
 		else {
-			for (i = 0, k = 0; i < step_count; i++)
-				for (j = 0; j < processor_count; j++, k++)
-					temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
+			ModalCondensedEquation::solve(total_power, temperature,
+				step_count, w);
 
 			/* Limit of iterations is reached,
 			 * quite right now.
@@ -255,65 +1121,55 @@ size_t LeakageCondensedEquation::solve(const double *dynamic_power,
 FixedCondensedEquation::FixedCondensedEquation(
 	size_t _processor_count, size_t _node_count, size_t _step_count,
 	double _sampling_interval, double _ambient_temperature,
-	const double **conductivity, const double *capacitance) :
+	const double **conductivity, const double *capacitance,
+	size_t _thread_count, const reduction_t &reduction) :
 
 	AnalyticalSolution(_processor_count, _node_count, _sampling_interval,
-		_ambient_temperature, conductivity, capacitance), step_count(_step_count)
+		_ambient_temperature, conductivity, capacitance, _thread_count,
+		reduction),
+	step_count(_step_count)
 {
-	P.resize(step_count, node_count);
-	Q.resize(step_count, node_count);
-	Y.resize(step_count, node_count);
-	R.resize(node_count, node_count);
+	prepare();
+}
 
-	double total_time = sampling_interval * step_count;
+void FixedCondensedEquation::prepare()
+{
+	R.resize(state_count, state_count);
 
 	/* M = diag(1/(1 - exp(Tau * l0)), ...) */
-	for (size_t i = 0; i < node_count; i++)
-		v_temp[i] = 1.0 / (1.0 - exp(total_time * L[i]));
+	calculate_M(step_count, M);
 
 	/* R = U * M * UT */
-	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
-	multiply_matrix_matrix(m_temp, UT, R);
+	matrix_t UM(state_count, state_count);
+	multiply_matrix_diagonal_matrix(U, M, UM);
+	multiply_matrix_matrix(UM, UT, R);
 }
 
-void FixedCondensedEquation::solve(
-	const double *power, double *temperature, size_t step_count)
+void FixedCondensedEquation::solve(const double *power, double *temperature,
+	size_t step_count, SolverWorkspace &w) const
 {
 	if (step_count != this->step_count)
 		throw std::runtime_error("The number of steps is invalid.");
 
-	size_t i, j, k;
-
-	Q.nullify();
-
-	/* Q(0) = G * B(0) */
-	multiply_matrix_incomplete_vector(G, power, processor_count, Q[0]);
-	/* P(0) = Q(0) */
-	__MEMCPY(P[0], Q[0], node_count);
+	solve_condensed(power, temperature, step_count, R, w);
+}
 
-	for (i = 1; i < step_count; i++) {
-		/* Q(i) = G * B(i) */
-		multiply_matrix_incomplete_vector(G, power + i * processor_count,
-			processor_count, Q[i]);
-		/* P(i) = K * P(i-1) + Q(i) */
-		multiply_matrix_vector_plus_vector(K, P[i - 1], Q[i], P[i]);
-	}
+void FixedCondensedEquation::solve(const PowerSegments &segments,
+	double *temperature) const
+{
+	if (segments.steps() != step_count)
+		throw std::runtime_error("The number of steps is invalid.");
 
-	/* Y(0) = R * P(m-1), for R see above ^ */
-	multiply_matrix_vector(R, P[step_count - 1], Y[0]);
+	solve_segments(segments, M, NULL, temperature);
+}
 
-	/* Y(i+1) = K * Y(i) + Q(i) */
-	for (i = 1; i < step_count; i++)
-		multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
+void FixedCondensedEquation::solve(const PowerSegments &segments,
+	const std::vector<size_t> &steps, double *temperature) const
+{
+	if (segments.steps() != step_count)
+		throw std::runtime_error("The number of steps is invalid.");
 
-	/* Return back to T from Y:
-	 * T = C^(-1/2) * Y
-	 *
-	 * And do not forget about the ambient temperature.
-	 */
-	for (i = 0, k = 0; i < step_count; i++)
-		for (j = 0; j < processor_count; j++, k++)
-			temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
+	solve_segments(segments, M, &steps, temperature);
 }
 
 /******************************************************************************/
@@ -322,82 +1178,88 @@ LeakageFixedCondensedEquation::LeakageFixedCondensedEquation(
 	size_t _processor_count, size_t _node_count, size_t _step_count,
 	double _sampling_interval, double _ambient_temperature,
 	double **conductivity, const double *capacitance,
-	const Leakage &_leakage) :
+	const Leakage &_leakage, size_t _history,
+	const reduction_t &reduction) :
 
 	FixedCondensedEquation(_processor_count, _node_count, _step_count,
 		_sampling_interval, _ambient_temperature,
 		(const double **)_leakage.setup(conductivity, _ambient_temperature),
-		capacitance), leakage(_leakage)
+		capacitance, 1, reduction), leakage(_leakage), history(_history)
 {
 }
 
 size_t LeakageFixedCondensedEquation::solve(const double *dynamic_power,
-	double *temperature, double *total_power, size_t step_count)
+	double *temperature, double *total_power, size_t step_count,
+	SolverWorkspace &w) const
 {
 	if (step_count != this->step_count)
 		throw std::runtime_error("The number of steps is invalid.");
 
-	size_t i, j, k, it;
-	double tmp, error, max_error;
-
-	Q.nullify();
+	size_t i, count, it;
+	double error, max_error;
 
 	const size_t max_iterations = leakage.get_max_iterations();
 	const double tolerance = leakage.get_tolerance();
 
+	/* Nothing to reuse with a single iteration */
+	if (max_iterations <= 1) {
+		leakage.inject(ambient_temperature, dynamic_power, total_power, step_count);
+		solve_condensed(total_power, temperature, step_count, R, w);
+		leakage.finalize(temperature, dynamic_power, total_power, step_count);
+		return 1;
+	}
+
+	w.T.resize(step_count, processor_count);
+	w.dynamic_temperature.resize(step_count, processor_count);
+	w.leakage_power.resize(step_count, processor_count);
+
+	double *_T = w.T;
+	double *_D = w.dynamic_temperature;
+	double *_B = w.leakage_power;
+	count = step_count * processor_count;
+
+	AndersonMixing &mixing = w.get_mixing(history);
+
+	/* The response to the dynamic power, including the ambient temperature */
+	solve_condensed(dynamic_power, _D, step_count, R, w);
+
+	/* The first guess is the ambient temperature */
+	for (i = 0; i < count; i++) temperature[i] = ambient_temperature;
+	mixing.reset(count);
+
 	leakage.inject(ambient_temperature, dynamic_power, total_power, step_count);
 
 	/* We come to the iterative part */
 	for (it = 1;; it++) {
-		/* Q(0) = G * B(0) */
-		multiply_matrix_incomplete_vector(G, total_power, processor_count, Q[0]);
-		/* P(0) = Q(0) */
-		__MEMCPY(P[0], Q[0], node_count);
-
-		for (i = 1; i < step_count; i++) {
-			/* Q(i) = G * B(i) */
-			multiply_matrix_incomplete_vector(G, total_power + i * processor_count,
-				processor_count, Q[i]);
-			/* P(i) = K * P(i-1) + Q(i) */
-			multiply_matrix_vector_plus_vector(K, P[i - 1], Q[i], P[i]);
-		}
-
-		/* Y(0) = R * P(m-1), for R see above ^ */
-		multiply_matrix_vector(R, P[step_count - 1], Y[0]);
-
-		/* Y(i+1) = K * Y(i) + Q(i) */
-		for (i = 1; i < step_count; i++)
-			multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
+		for (i = 0; i < count; i++)
+			_B[i] = total_power[i] - dynamic_power[i];
 
-		/* Return back to T from Y:
-		 * T = C^(-1/2) * Y
-		 *
-		 * And do not forget about the ambient temperature. Also perform
-		 * the error control.
-		 */
 		if (it < max_iterations) {
+			__MEMCPY(_T, _D, count);
+			superpose(_B, _T, step_count, M, w);
+
 			/* There is a reason to check the error.
 			 */
 			max_error = 0;
-			for (i = 0, k = 0; i < step_count; i++)
-				for (j = 0; j < processor_count; j++, k++) {
-					tmp = Y[i][j] * sinvC[j] + ambient_temperature;
-
-					error = std::abs(temperature[k] - tmp);
-					if (max_error < error) max_error = error;
-
-					temperature[k] = tmp;
-				}
+			for (i = 0; i < count; i++) {
+				error = std::abs(temperature[i] - _T[i]);
+				if (max_error < error) max_error = error;
+			}
 
 			/* Still have some iterations left,
 			 * the only question is the error.
 			 */
-			if (max_error < tolerance) break;
+			if (max_error < tolerance) {
+				__MEMCPY(temperature, _T, count);
+				break;
+			}
+
+			/* Without acceleration, the next guess is just _T */
+			mixing.next(temperature, _T);
 		}
 		else {
-			for (i = 0, k = 0; i < step_count; i++)
-				for (j = 0; j < processor_count; j++, k++)
-					temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
+			__MEMCPY(temperature, _D, count);
+			superpose(_B, temperature, step_count, M, w);
 
 			/* Limit of iterations is reached,
 			 * quite right now.
@@ -418,11 +1280,25 @@ size_t LeakageFixedCondensedEquation::solve(const double *dynamic_power,
 BasicSteadyStateAnalyticalSolution::BasicSteadyStateAnalyticalSolution(
 	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
-	const double **conductivity, const double *capacitance) :
+	const double **conductivity, const double *capacitance,
+	const reduction_t &reduction) :
 
 	AnalyticalSolution(_processor_count, _node_count, _sampling_interval,
-		_ambient_temperature, conductivity, capacitance)
+		_ambient_temperature, conductivity, capacitance, 1, reduction)
 {
+	if (reduced()) {
+		R.resize(state_count, processor_count);
+
+		/* In the eigenbasis, Z = E * Z + H * B, hence,
+		 * Z = H * B / (1 - E) = R * B
+		 */
+		for (size_t i = 0; i < state_count; i++)
+			for (size_t j = 0; j < processor_count; j++)
+				R[i][j] = H[i][j] / (1 - E[i]);
+
+		return;
+	}
+
 	R.resize(node_count, node_count);
 
 	/* Solve:
@@ -434,7 +1310,8 @@ BasicSteadyStateAnalyticalSolution::BasicSteadyStateAnalyticalSolution(
 	 * for the negative matrix.
 	 */
 
-	matrix_t m_temp2(node_count, node_count);
+	vector_t v_temp(node_count);
+	matrix_t m_temp(node_count, node_count), m_temp2(node_count, node_count);
 
 	for (size_t j = 0; j < node_count; j++) v_temp[j] = - 1.0 / L[j];
 	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
@@ -447,25 +1324,27 @@ BasicSteadyStateAnalyticalSolution::BasicSteadyStateAnalyticalSolution(
 SteadyStateAnalyticalSolution::SteadyStateAnalyticalSolution(
 	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
-	const double **conductivity, const double *capacitance) :
+	const double **conductivity, const double *capacitance,
+	const reduction_t &reduction) :
 
 	BasicSteadyStateAnalyticalSolution(
 		_processor_count, _node_count, _sampling_interval,
-		_ambient_temperature, conductivity, capacitance)
+		_ambient_temperature, conductivity, capacitance, reduction)
 {
 }
 
-void SteadyStateAnalyticalSolution::solve(
-	const double *power, double *temperature, size_t step_count)
+void SteadyStateAnalyticalSolution::solve(const double *power,
+	double *temperature, size_t step_count, SolverWorkspace &w) const
 {
-	size_t i, j, k;
+	vector_t &v_temp = w.v_temp;
 
-	for (i = 0, k = 0; i < step_count; i++) {
+	v_temp.resize(R.rows());
+
+	for (size_t i = 0; i < step_count; i++) {
 		multiply_matrix_incomplete_vector(
 			R, power + i * processor_count, processor_count, v_temp);
 
-		for (j = 0; j < processor_count; j++, k++)
-			temperature[k] = v_temp[j] * sinvC[j] + ambient_temperature;
+		observe(v_temp, temperature + i * processor_count);
 	}
 }
 
@@ -475,24 +1354,40 @@ LeakageSteadyStateAnalyticalSolution::LeakageSteadyStateAnalyticalSolution(
 	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
 	double **conductivity, const double *capacitance,
-	const Leakage &_leakage) :
+	const Leakage &_leakage, size_t _history,
+	const reduction_t &reduction) :
 
 	BasicSteadyStateAnalyticalSolution(_processor_count, _node_count,
 		_sampling_interval, _ambient_temperature,
 		(const double **)_leakage.setup(conductivity, _ambient_temperature),
-		capacitance), leakage(_leakage)
+		capacitance, reduction), leakage(_leakage), history(_history)
 {
 }
 
 size_t LeakageSteadyStateAnalyticalSolution::solve(const double *dynamic_power,
-	double *temperature, double *total_power, size_t step_count)
+	double *temperature, double *total_power, size_t step_count,
+	SolverWorkspace &w) const
 {
 	size_t iterations, i, j, k;
-	double tmp, error, max_error;
+	double error, max_error;
 
 	const size_t max_iterations = leakage.get_max_iterations();
 	const double tolerance = leakage.get_tolerance();
 
+	const size_t count = step_count * processor_count;
+
+	w.T.resize(step_count, processor_count);
+	double *_T = w.T;
+
+	vector_t &v_temp = w.v_temp;
+	v_temp.resize(R.rows());
+
+	AndersonMixing &mixing = w.get_mixing(history);
+
+	/* The first guess is the ambient temperature */
+	for (k = 0; k < count; k++) temperature[k] = ambient_temperature;
+	mixing.reset(count);
+
 	leakage.inject(ambient_temperature, dynamic_power, total_power, step_count);
 
 	for (iterations = 0; iterations < max_iterations; iterations++) {
@@ -501,21 +1396,26 @@ size_t LeakageSteadyStateAnalyticalSolution::solve(const double *dynamic_power,
 			multiply_matrix_incomplete_vector(
 				R, total_power + i * processor_count, processor_count, v_temp);
 
-			for (j = 0; j < processor_count; j++, k++) {
-				tmp = v_temp[j] * sinvC[j] + ambient_temperature;
+			observe(v_temp, _T + i * processor_count);
 
-				error = std::abs(temperature[k] - tmp);
+			for (j = 0; j < processor_count; j++, k++) {
+				error = std::abs(temperature[k] - _T[k]);
 				if (max_error < error) max_error = error;
-
-				temperature[k] = tmp;
 			}
 		}
 
 		if (max_error < tolerance) {
+			__MEMCPY(temperature, _T, count);
 			iterations++;
 			break;
 		}
 
+		/* The last guess is not extrapolated */
+		if (iterations + 1 < max_iterations)
+			mixing.next(temperature, _T);
+		else
+			__MEMCPY(temperature, _T, count);
+
 		leakage.inject(temperature, dynamic_power, total_power, step_count);
 	}
 
@@ -530,106 +1430,89 @@ TransientAnalyticalSolution::TransientAnalyticalSolution(
 	size_t _processor_count, size_t _node_count,
 	double _sampling_interval, double _ambient_temperature,
 	const double **conductivity, const double *capacitance,
-	size_t _max_iterations, double _tolerance, bool _warmup) :
+	size_t _max_iterations, double _tolerance, bool _warmup,
+	const reduction_t &reduction) :
 
 	AnalyticalSolution(_processor_count, _node_count, _sampling_interval,
-		_ambient_temperature, conductivity, capacitance),
+		_ambient_temperature, conductivity, capacitance, 1, reduction),
 	max_iterations(_max_iterations), tolerance(_tolerance), warmup(_warmup)
 {
 }
 
 void TransientAnalyticalSolution::solve_fixed_iterations(
-	const double *power, double *temperature, size_t step_count)
+	const double *power, double *temperature, size_t step_count,
+	SolverWorkspace &w) const
 {
-	size_t iterations, i, j, k;
-
-	initialize(power, step_count);
-
-	for (i = 1; i < step_count; i++) {
-		/* Y(i) = K * Y(i-1) + Q(i)
-		 *
-		 * Note: Indexes are shifted here for Q.
-		 */
-		multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
-	}
-
-	for (iterations = 1; iterations < max_iterations; iterations++) {
-		/* Wrap around:
-		 *
-		 * Y(1) = K * Y(N_s - 1) + Q(N_s - 1)
-		 */
-		multiply_matrix_vector_plus_vector(
-			K, Y[step_count - 1], Q[step_count - 1], Y[0]);
+	vector_t &Y = w.Z;
 
-		for (i = 1; i < step_count; i++) {
-			/* Y(i) = K * Y(i-1) + Q(i) */
-			multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
-		}
-	}
+	initialize(power, step_count, Y);
 
-	/* Return back to T from Y:
-	 * T = C^(-1/2) * Y
+	/* Y(i) = K * Y(i-1) + Q(i-1), and each sweep ends up with
+	 * the wrap around:
 	 *
-	 * And do not forget about the ambient temperature.
+	 * Y(0) = K * Y(N_s - 1) + Q(N_s - 1)
 	 */
-	for (i = 0, k = 0; i < step_count; i++)
-		for (j = 0; j < processor_count; j++, k++)
-			temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
+	propagate(power, 0, step_count, Y, temperature);
+
+	for (size_t iterations = 1; iterations < max_iterations; iterations++)
+		propagate(power, 0, step_count, Y, temperature);
 }
 
 void TransientAnalyticalSolution::solve_error_control(
-	const double *power, double *temperature, size_t step_count)
+	const double *power, double *temperature, size_t step_count,
+	SolverWorkspace &w) const
 {
-	size_t iterations, i, j, k;
-	double tmp, error, max_error;
+	size_t iterations, i, count;
+	double error, max_error;
 
-	initialize(power, step_count);
+	vector_t &Y = w.Z;
 
-	for (i = 1; i < step_count; i++) {
-		multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
-	}
+	w.T.resize(step_count, processor_count);
 
-	for (i = 0, k = 0; i < step_count; i++)
-		for (j = 0; j < processor_count; j++, k++)
-			temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
+	double *_T = w.T;
+	count = step_count * processor_count;
 
-	for (iterations = 1; iterations < max_iterations; iterations++) {
-		multiply_matrix_vector_plus_vector(K, Y[step_count - 1],
-			Q[step_count - 1], Y[0]);
+	initialize(power, step_count, Y);
 
-		for (i = 1; i < step_count; i++) {
-			multiply_matrix_vector_plus_vector(K, Y[i - 1], Q[i - 1], Y[i]);
-		}
+	propagate(power, 0, step_count, Y, temperature);
 
-		max_error = 0;
-		for (i = 0, k = 0; i < step_count; i++)
-			for (j = 0; j < processor_count; j++, k++) {
-				tmp = Y[i][j] * sinvC[j] + ambient_temperature;
+	for (iterations = 1; iterations < max_iterations; iterations++) {
+		propagate(power, 0, step_count, Y, _T);
 
-				error = std::abs(temperature[k] - tmp);
-				if (max_error < error) max_error = error;
+		max_error = 0;
+		for (i = 0; i < count; i++) {
+			error = std::abs(temperature[i] - _T[i]);
+			if (max_error < error) max_error = error;
+		}
 
-				temperature[k] = tmp;
-			}
+		__MEMCPY(temperature, _T, count);
 
 		if (max_error < tolerance) break;
 	}
 }
 
-void TransientAnalyticalSolution::initialize(const double *power, size_t step_count)
+void TransientAnalyticalSolution::initialize(const double *power,
+	size_t step_count, vector_t &Y) const
 {
 	size_t i, j;
 
-	Y.resize(step_count, node_count);
-	Q.resize(step_count, node_count);
+	Y.resize(state_count);
 
-	for (i = 0; i < step_count; i++) {
-		/* Q(i) = G * B(i) */
-		multiply_matrix_incomplete_vector(G, power + i * processor_count,
-			processor_count, Q[i]);
-	}
+	if (warmup && reduced()) {
+		/* The same in the eigenbasis, Z = H * P / (1 - E) */
+		vector_t P(processor_count, 0);
+
+		for (i = 0; i < processor_count; i++) {
+			for (j = 0; j < step_count; j++)
+				P[i] += power[j * processor_count + i];
+			P[i] /= double(step_count);
+		}
+
+		multiply_matrix_incomplete_vector(H, P, processor_count, Y);
 
-	if (warmup) {
+		for (i = 0; i < state_count; i++) Y[i] = Y[i] / (1 - E[i]);
+	}
+	else if (warmup) {
 		/* Solve:
 		 * G * T = P
 		 * C^(-1/2) * G * C^(-1/2) * C^(1/2) * T = C^(-1/2) * P
@@ -639,8 +1522,9 @@ void TransientAnalyticalSolution::initialize(const double *power, size_t step_co
 		 * for the negative matrix.
 		 */
 
+		vector_t v_temp(node_count, 0);
+
 		/* C^(-1/2) * P (average power) */
-		v_temp.nullify();
 		for (i = 0; i < processor_count; i++) {
 			for (j = 0; j < step_count; j++)
 				v_temp[i] = v_temp[i] + power[j * processor_count + i];
@@ -648,25 +1532,24 @@ void TransientAnalyticalSolution::initialize(const double *power, size_t step_co
 		}
 
 		/* U^T * C^(-1/2) * P */
-		multiply_matrix_incomplete_vector(UT, v_temp, processor_count, Y[0]);
+		multiply_matrix_incomplete_vector(UT, v_temp, processor_count, Y);
 
 		/* L^(-1) * U^T * C^(-1/2) * P */
-		for (i = 0; i < node_count; i++) v_temp[i] = - Y[0][i] / L[i];
+		for (i = 0; i < state_count; i++) v_temp[i] = - Y[i] / L[i];
 
 		/* U * L^(-1) * U^T * C^(-1/2) * P */
-		multiply_matrix_vector(U, v_temp, Y[0]);
+		multiply_matrix_vector(U, v_temp, Y);
 	}
 	else {
 		/* We start from zero temperature.
 		 */
-		__NULLIFY(Y[0], node_count);
+		Y.nullify();
 	}
 }
 
 size_t  TransientAnalyticalSolution::verify(const double *power,
-	double *temperature, size_t step_count, const double *reference)
+	double *temperature, size_t step_count, const double *reference) const
 {
-	int p;
 	size_t i, j, k, iterations;
 	double min = DBL_MAX, max = -DBL_MAX, error, delta;
 
@@ -676,20 +1559,18 @@ size_t  TransientAnalyticalSolution::verify(const double *power,
 			max = std::max(reference[i * processor_count + j], max);
 		}
 
-	initialize(power, step_count);
+	vector_t Y;
 
-	for (iterations = 0, p = -1; iterations < max_iterations; iterations++) {
-		error = 0;
+	initialize(power, step_count, Y);
+
+	for (iterations = 0; iterations < max_iterations; iterations++) {
+		propagate(power, 0, step_count, Y, temperature);
 
-		for (i = 0, k = 0; i < step_count; i++, p = (p + 1) % step_count) {
-			if (p >= 0)
-				multiply_matrix_vector_plus_vector(K, Y[p], Q[p], Y[i]);
+		error = 0;
 
-			for (j = 0; j < processor_count; j++, k++) {
-				temperature[k] = Y[i][j] * sinvC[j] + ambient_temperature;
-				delta = reference[k] - temperature[k];
-				error += delta * delta;
-			}
+		for (k = 0; k < step_count * processor_count; k++) {
+			delta = reference[k] - temperature[k];
+			error += delta * delta;
 		}
 
 		error = std::sqrt(error / double(step_count * processor_count)) / (max - min);
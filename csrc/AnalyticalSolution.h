@@ -3,11 +3,71 @@
 
 #include "common.h"
 #include "Leakage.h"
+#include "AndersonMixing.h"
+#include "DynamicPower.h"
+#include "ThermalModel.h"
 
 #ifdef MEASURE_TIME
 #include "Helper.h"
 #endif
 
+#define MAX_CACHED_OPERATORS 8
+#define MAX_CACHED_DECOMPOSITIONS 16
+#define UPDATE_CHUNK_LENGTH 32
+
+/* Everything that the analytical solutions change while solving. One
+ * workspace per thread, and the same solution can serve several threads
+ * at once through the entry points that take a workspace.
+ */
+struct SolverWorkspace
+{
+	matrix_t m_temp;
+	vector_t v_temp;
+
+	/* State vectors of a single profile */
+	vector_t Z;
+	vector_t S;
+
+	/* The states of several steps and their temperature, projected
+	 * from one to the other at once, see superpose.
+	 */
+	matrix_t ZT;
+	matrix_t TT;
+
+	/* Power profiles of a batch stacked step by step and
+	 * the recurrences for the whole batch at once.
+	 */
+	matrix_t X;
+	matrix_t P;
+	matrix_t Q;
+	matrix_t Y;
+
+	/* R = U * M * UT for the recently used numbers of steps,
+	 * valid for the model they were computed for.
+	 */
+	typedef std::pair<size_t, matrix_t> operator_t;
+	std::list<operator_t> operators;
+	const void *model;
+
+	/* The leakage iterations */
+	matrix_t T;
+	matrix_t dynamic_temperature;
+	matrix_t leakage_power;
+	AndersonMixing mixing;
+	std::vector<AndersonMixing> mixings;
+
+	/* The number of the leakage iterations of the last solution */
+	size_t iterations;
+
+	SolverWorkspace() : model(NULL), iterations(0) {}
+
+	inline AndersonMixing &get_mixing(size_t depth)
+	{
+		if (mixing.get_depth() != depth) mixing = AndersonMixing(depth);
+		return mixing;
+	}
+};
+
 class AnalyticalSolution
 {
 #ifdef MEASURE_TIME
@@ -18,68 +78,362 @@ class AnalyticalSolution
 
 	protected:
 
+	/* Built by the solution itself and shared by the threads
+	 * that solve with it.
+	 */
+	const ThermalModel *model;
+
 	const size_t processor_count;
 	const size_t node_count;
+	const size_t state_count;
 
 	const double sampling_interval;
 	const double ambient_temperature;
 
-	/* Matrix exponent */
-	matrix_t K;
+	/* The number of threads for parallel-in-time solutions */
+	const size_t thread_count;
 
-	vector_t sinvC;
-	matrix_t G;
+	/* Shortcuts to the model, see ThermalModel */
+	const vector_t &sinvC;
+	const matrix_t &KT;
+	const matrix_t &GT;
+	const vector_t &L;
+	const matrix_t &U;
+	const matrix_t &UT;
+	const vector_t &E;
+	const matrix_t &H;
+	const matrix_t &HT;
+	const matrix_t &W;
 
-	/* Eigenvector decomposition
-	 *
-	 * D = U * L * UT
-	 */
-	vector_t L;
-	matrix_t U;
-	matrix_t UT;
-
-	matrix_t m_temp;
-	vector_t v_temp;
+	/* For the entry points without a workspace */
+	SolverWorkspace workspace;
 
 	public:
 
 	AnalyticalSolution(size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
-		const double **conductivity, const double *capacitance);
-};
+		const double **conductivity, const double *capacitance,
+		size_t _thread_count = 1,
+		const reduction_t &reduction = reduction_t());
+	~AnalyticalSolution();
+
+	inline const ThermalModel &get_model() const
+	{
+		return *model;
+	}
+
+	inline size_t get_state_count() const
+	{
+		return state_count;
+	}
+
+	inline double get_error_bound() const
+	{
+		return model->error_bound;
+	}
 
-class CondensedEquation: public AnalyticalSolution
-{
 	protected:
 
-	matrix_t P;
-	matrix_t Q;
-	matrix_t Y;
+	inline bool reduced() const
+	{
+		return model->reduced();
+	}
+
+	inline void observe(const double *Y, double *temperature) const
+	{
+		model->observe(Y, temperature);
+	}
+
+	/* Periodic solution, where R = U * M * UT. Only two vectors of
+	 * node_count elements are kept, P(m-1) and Y in S and Z of
+	 * the workspace, Q is recomputed from the power when needed, and
+	 * only the processor part of Y is projected to the temperature.
+	 */
+	void solve_condensed(const double *power, double *temperature,
+		size_t step_count, const matrix_t &R, SolverWorkspace &w) const;
+
+	/* The same with the time axis split into thread_count chunks.
+	 * First, each chunk accumulates its own part of P(m-1) in parallel.
+	 * Then the chunks are chained with K^(chunk length), and Y at
+	 * the beginning of each chunk is found. Finally, the chunks fill
+	 * in the temperature in parallel.
+	 */
+	void solve_parallel(const double *power, double *temperature,
+		size_t step_count, const matrix_t &R) const;
+
+	/* P = K^(last - first) * P + sum K^(last - 1 - i) * G * B(i),
+	 * where i goes over [first, last).
+	 */
+	void accumulate(const double *power, size_t first, size_t last,
+		double *P) const;
+
+	/* Fills in the temperature for [first, last) starting from Y(first),
+	 * Y(last) is left in Y.
+	 */
+	void propagate(const double *power, size_t first, size_t last,
+		double *Y, double *temperature) const;
+
+	/* Adds the periodic response to the power, without the ambient
+	 * temperature, to the temperature. The response is computed in
+	 * the eigenbasis, where M = diag(1/(1 - exp(Tau * l0)), ...).
+	 */
+	void superpose(const double *power, double *temperature,
+		size_t step_count, const double *M, SolverWorkspace &w) const;
+
+	/* Periodic solution for a run-length encoded power profile,
+	 * where M = diag(1/(1 - exp(Tau * l0)), ...). The temperature is
+	 * computed at the given steps (sorted) or, if there are none,
+	 * at the first step of each segment. Optionally, the average
+	 * temperature of each segment is computed as well.
+	 */
+	void solve_segments(const PowerSegments &segments, const double *M,
+		const std::vector<size_t> *steps, double *temperature,
+		double *average = NULL) const;
+
+	/* M = diag(1/(1 - exp(Tau * l0)), ...) */
+	void calculate_M(size_t step_count, vector_t &M) const;
+
+	private:
 
+	/* The model may be owned, hence, no copies */
+	AnalyticalSolution(const AnalyticalSolution &);
+
+	struct chunk_t;
+
+	static void *solve_chunk(void *argument);
+	static void solve_chunks(std::vector<chunk_t> &chunks);
+};
+
+class CondensedEquation: public AnalyticalSolution
+{
 	public:
 
 	CondensedEquation(size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
-		const double **conductivity, const double *capacitance);
+		const double **conductivity, const double *capacitance,
+		size_t _thread_count = 1,
+		const reduction_t &reduction = reduction_t());
 
 	/* NOTE: power should be of size (step_count x processor_count) */
-	void solve(const double *power, double *temperature, size_t step_count);
+	inline void solve(const double *power, double *temperature,
+		size_t step_count)
+	{
+		solve(power, temperature, step_count, workspace);
+	}
+
+	void solve(const double *power, double *temperature, size_t step_count,
+		SolverWorkspace &w) const;
+
+	/* NOTE: temperature should be of size (segment_count x processor_count) */
+	void solve(const PowerSegments &segments, double *temperature) const;
+
+	/* NOTE: temperature should be of size (steps.size() x processor_count) */
+	void solve(const PowerSegments &segments,
+		const std::vector<size_t> &steps, double *temperature) const;
+
+	/* NOTE: each power and temperature should be of size
+	 * (step_count x processor_count)
+	 */
+	inline void solve(const std::vector<const double *> &power,
+		const std::vector<double *> &temperature, size_t step_count)
+	{
+		solve(power, temperature, step_count, workspace);
+	}
+
+	void solve(const std::vector<const double *> &power,
+		const std::vector<double *> &temperature, size_t step_count,
+		SolverWorkspace &w) const;
+
+	/* The periodic solution for a power that does not change in time,
+	 * that is, the steady state.
+	 *
+	 * NOTE: power and temperature should be of size processor_count
+	 */
+	void solve_steady(const double *power, double *temperature) const;
+
+	protected:
+
+	/* R = U * M * UT depends on the number of steps only, hence,
+	 * it is kept in the workspace for the recently used numbers of steps.
+	 */
+	const matrix_t &calculate_R(size_t step_count, SolverWorkspace &w) const;
+
+	/* Fills in Q, P, and Y of the workspace for the first count
+	 * profiles stacked in X: the i-th step of the b-th profile is
+	 * the (i * count + b)-th row.
+	 */
+	void solve_stack(size_t step_count, size_t count,
+		SolverWorkspace &w) const;
 };
 
+/* The system is linear in the power, hence, the response to
+ * the dynamic power is found once, and only the response to
+ * the leakage is recomputed in the eigenbasis.
+ */
 class LeakageCondensedEquation: public CondensedEquation
 {
 	const Leakage &leakage;
 
+	/* The depth of the Anderson acceleration of the leakage iterations,
+	 * zero turns it off.
+	 */
+	const size_t history;
+
 	public:
 
 	LeakageCondensedEquation(size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
 		double **conductivity, const double *capacitance,
-		const Leakage &_leakage);
+		const Leakage &_leakage, size_t _history,
+		const reduction_t &reduction = reduction_t());
 
 	/* NOTE: dynamic_power should be of size (step_count x processor_count) */
+	inline size_t solve(const double *dynamic_power,
+		double *temperature, double *total_power, size_t step_count)
+	{
+		return solve(dynamic_power, temperature, total_power,
+			step_count, workspace);
+	}
+
+	size_t solve(const double *dynamic_power,
+		double *temperature, double *total_power, size_t step_count,
+		SolverWorkspace &w) const;
+
+	/* NOTE: temperature and total_power should be of size
+	 * (segment_count x processor_count), the leakage is computed
+	 * from the average temperature of each segment.
+	 */
+	size_t solve(const PowerSegments &dynamic_power,
+		double *temperature, double *total_power) const;
+
+	/* NOTE: each dynamic_power, temperature, and total_power should be
+	 * of size (step_count x processor_count), every profile iterates
+	 * until its own convergence. Returns the maximal number of iterations.
+	 */
+	inline size_t solve(const std::vector<const double *> &dynamic_power,
+		const std::vector<double *> &temperature,
+		const std::vector<double *> &total_power, size_t step_count)
+	{
+		return solve(dynamic_power, temperature, total_power,
+			step_count, workspace);
+	}
+
+	size_t solve(const std::vector<const double *> &dynamic_power,
+		const std::vector<double *> &temperature,
+		const std::vector<double *> &total_power, size_t step_count,
+		SolverWorkspace &w) const;
+};
+
+/* The leakage is linearized in temperature bands, and the slopes of
+ * the bands of all the processors are folded into the conductance.
+ * Each combination of bands, thus, is a model of its own, the models of
+ * the recently seen combinations are kept. The bands are chosen from
+ * the steady state for the average power and, then, corrected
+ * at most once according to the actual solution.
+ */
+class BandedCondensedEquation
+{
+	const size_t processor_count;
+	const size_t node_count;
+
+	const double sampling_interval;
+	const double ambient_temperature;
+
+	const BandedLinearLeakage &leakage;
+
+	/* The reduction of the model of each band */
+	const reduction_t reduction;
+
+	matrix_t conductivity;
+	vector_t capacitance;
+
+	typedef std::pair<std::vector<size_t>, CondensedEquation *> model_t;
+	std::list<model_t> models;
+
+	/* The largest order and error bound among the models of the bands
+	 * built so far.
+	 */
+	size_t state_count;
+	double error_bound;
+
+	public:
+
+	BandedCondensedEquation(size_t _processor_count, size_t _node_count,
+		double _sampling_interval, double _ambient_temperature,
+		const double **conductivity, const double *capacitance,
+		const BandedLinearLeakage &_leakage,
+		const reduction_t &_reduction = reduction_t());
+	~BandedCondensedEquation();
+
+	/* NOTE: dynamic_power should be of size (step_count x processor_count),
+	 * returns the number of solutions.
+	 */
 	size_t solve(const double *dynamic_power,
 		double *temperature, double *total_power, size_t step_count);
+
+	inline size_t get_state_count() const
+	{
+		return state_count;
+	}
+
+	inline double get_error_bound() const
+	{
+		return error_bound;
+	}
+
+	private:
+
+	CondensedEquation &get_model(const std::vector<size_t> &bands);
+
+	/* The bands for the temperature profile of each processor */
+	void select(const double *temperature, size_t step_count,
+		std::vector<size_t> &bands) const;
+};
+
+class ModalCondensedEquation: public AnalyticalSolution
+{
+	public:
+
+	ModalCondensedEquation(size_t _processor_count, size_t _node_count,
+		double _sampling_interval, double _ambient_temperature,
+		const double **conductivity, const double *capacitance,
+		const reduction_t &reduction = reduction_t());
+
+	/* NOTE: power should be of size (step_count x processor_count) */
+	inline void solve(const double *power, double *temperature,
+		size_t step_count)
+	{
+		solve(power, temperature, step_count, workspace);
+	}
+
+	void solve(const double *power, double *temperature, size_t step_count,
+		SolverWorkspace &w) const;
+};
+
+class LeakageModalCondensedEquation: public ModalCondensedEquation
+{
+	const Leakage &leakage;
+	const size_t history;
+
+	public:
+
+	LeakageModalCondensedEquation(size_t _processor_count, size_t _node_count,
+		double _sampling_interval, double _ambient_temperature,
+		double **conductivity, const double *capacitance,
+		const Leakage &_leakage, size_t _history,
+		const reduction_t &reduction = reduction_t());
+
+	/* NOTE: dynamic_power should be of size (step_count x processor_count) */
+	inline size_t solve(const double *dynamic_power,
+		double *temperature, double *total_power, size_t step_count)
+	{
+		return solve(dynamic_power, temperature, total_power,
+			step_count, workspace);
+	}
+
+	size_t solve(const double *dynamic_power,
+		double *temperature, double *total_power, size_t step_count,
+		SolverWorkspace &w) const;
 };
 
 class FixedCondensedEquation: public AnalyticalSolution
@@ -88,33 +442,65 @@ class FixedCondensedEquation: public AnalyticalSolution
 
 	const size_t step_count;
 
-	matrix_t P;
-	matrix_t Q;
-	matrix_t Y;
 	matrix_t R;
 
+	/* M = diag(1/(1 - exp(Tau * l0)), ...) */
+	vector_t M;
+
 	public:
 
 	FixedCondensedEquation(size_t _processor_count, size_t _node_count,
 		size_t _step_count, double _sampling_interval, double _ambient_temperature,
-		const double **conductivity, const double *capacitance);
+		const double **conductivity, const double *capacitance,
+		size_t _thread_count = 1,
+		const reduction_t &reduction = reduction_t());
+
+	inline void solve(const double *power, double *temperature,
+		size_t step_count)
+	{
+		solve(power, temperature, step_count, workspace);
+	}
+
+	void solve(const double *power, double *temperature, size_t step_count,
+		SolverWorkspace &w) const;
+
+	/* NOTE: temperature should be of size (segment_count x processor_count) */
+	void solve(const PowerSegments &segments, double *temperature) const;
 
-	void solve(const double *power, double *temperature, size_t step_count);
+	/* NOTE: temperature should be of size (steps.size() x processor_count) */
+	void solve(const PowerSegments &segments,
+		const std::vector<size_t> &steps, double *temperature) const;
+
+	private:
+
+	/* Computes R and M */
+	void prepare();
 };
 
+/* The same superposition as in LeakageCondensedEquation */
 class LeakageFixedCondensedEquation: public FixedCondensedEquation
 {
 	const Leakage &leakage;
+	const size_t history;
 
 	public:
 
 	LeakageFixedCondensedEquation(size_t _processor_count, size_t _node_count,
 		size_t _step_count, double _sampling_interval, double _ambient_temperature,
 		double **conductivity, const double *capacitance,
-		const Leakage &_leakage);
+		const Leakage &_leakage, size_t _history,
+		const reduction_t &reduction = reduction_t());
+
+	inline size_t solve(const double *dynamic_power,
+		double *temperature, double *total_power, size_t step_count)
+	{
+		return solve(dynamic_power, temperature, total_power,
+			step_count, workspace);
+	}
 
 	size_t solve(const double *dynamic_power,
-		double *temperature, double *total_power, size_t step_count);
+		double *temperature, double *total_power, size_t step_count,
+		SolverWorkspace &w) const;
 };
 
 class BasicSteadyStateAnalyticalSolution: public AnalyticalSolution
@@ -127,9 +513,16 @@ class BasicSteadyStateAnalyticalSolution: public AnalyticalSolution
 
 	BasicSteadyStateAnalyticalSolution(size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
-		const double **conductivity, const double *capacitance);
+		const double **conductivity, const double *capacitance,
+		const reduction_t &reduction = reduction_t());
+
+	inline void solve(const double *power, double *temperature, size_t step_count = 1)
+	{
+		solve(power, temperature, step_count, workspace);
+	}
 
-	virtual void solve(const double *power, double *temperature, size_t step_count = 1) = 0;
+	virtual void solve(const double *power, double *temperature,
+		size_t step_count, SolverWorkspace &w) const = 0;
 };
 
 class SteadyStateAnalyticalSolution: public BasicSteadyStateAnalyticalSolution
@@ -138,14 +531,19 @@ class SteadyStateAnalyticalSolution: public BasicSteadyStateAnalyticalSolution
 
 	SteadyStateAnalyticalSolution(size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
-		const double **conductivity, const double *capacitance);
+		const double **conductivity, const double *capacitance,
+		const reduction_t &reduction = reduction_t());
 
-	void solve(const double *power, double *temperature, size_t step_count = 1);
+	using BasicSteadyStateAnalyticalSolution::solve;
+
+	void solve(const double *power, double *temperature, size_t step_count,
+		SolverWorkspace &w) const;
 };
 
 class LeakageSteadyStateAnalyticalSolution: public BasicSteadyStateAnalyticalSolution
 {
 	const Leakage &leakage;
+	const size_t history;
 
 	public:
 
@@ -153,16 +551,28 @@ class LeakageSteadyStateAnalyticalSolution: public BasicSteadyStateAnalyticalSol
 		size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
 		double **conductivity, const double *capacitance,
-		const Leakage &_leakage);
+		const Leakage &_leakage, size_t _history,
+		const reduction_t &reduction = reduction_t());
 
-	inline void solve(const double *power, double *temperature, size_t step_count = 1)
+	using BasicSteadyStateAnalyticalSolution::solve;
+
+	inline void solve(const double *power, double *temperature,
+		size_t step_count, SolverWorkspace &w) const
 	{
 		matrix_t total_power(step_count, processor_count);
-		(void)solve(power, temperature, total_power, step_count);
+		(void)solve(power, temperature, total_power, step_count, w);
+	}
+
+	inline size_t solve(const double *dynamic_power,
+		double *temperature, double *total_power, size_t step_count = 1)
+	{
+		return solve(dynamic_power, temperature, total_power,
+			step_count, workspace);
 	}
 
 	size_t solve(const double *dynamic_power,
-		double *temperature, double *total_power, size_t step_count = 1);
+		double *temperature, double *total_power, size_t step_count,
+		SolverWorkspace &w) const;
 };
 
 class TransientAnalyticalSolution: public AnalyticalSolution
@@ -171,34 +581,40 @@ class TransientAnalyticalSolution: public AnalyticalSolution
 	const double tolerance;
 	const bool warmup;
 
-	matrix_t Q;
-	matrix_t Y;
-
 	public:
 
 	TransientAnalyticalSolution(size_t _processor_count, size_t _node_count,
 		double _sampling_interval, double _ambient_temperature,
 		const double **conductivity, const double *capacitance,
-		size_t _max_iterations, double _tolerance, bool _warmup);
+		size_t _max_iterations, double _tolerance, bool _warmup,
+		const reduction_t &reduction = reduction_t());
 
 	inline void solve(const double *power, double *temperature, size_t step_count)
+	{
+		solve(power, temperature, step_count, workspace);
+	}
+
+	/* Y at the first step of the next sweep is Z of the workspace */
+	inline void solve(const double *power, double *temperature,
+		size_t step_count, SolverWorkspace &w) const
 	{
 		if (tolerance == 0)
-			solve_fixed_iterations(power, temperature, step_count);
+			solve_fixed_iterations(power, temperature, step_count, w);
 		else
-			solve_error_control(power, temperature, step_count);
+			solve_error_control(power, temperature, step_count, w);
 	}
 
 	size_t verify(const double *power, double *temperature, size_t step_count,
-		const double *reference);
+		const double *reference) const;
 
 	private:
 
-	void solve_fixed_iterations(
-		const double *power, double *temperature, size_t step_count);
-	void solve_error_control(
-		const double *power, double *temperature, size_t step_count);
-	void initialize(const double *power, size_t step_count);
+	void solve_fixed_iterations(const double *power, double *temperature,
+		size_t step_count, SolverWorkspace &w) const;
+	void solve_error_control(const double *power, double *temperature,
+		size_t step_count, SolverWorkspace &w) const;
+	void initialize(const double *power, size_t step_count,
+		vector_t &Y) const;
 };
 
 class CoarseCondensedEquation
@@ -0,0 +1,118 @@
+#include "AndersonMixing.h"
+
+AndersonMixing::AndersonMixing(size_t _depth) :
+	depth(_depth), size(0), count(0), position(0), started(false)
+{
+}
+
+void AndersonMixing::reset(size_t _size)
+{
+	size = _size;
+	count = 0;
+	position = 0;
+	started = false;
+
+	if (!depth) return;
+
+	dF.resize(depth, size);
+	dG.resize(depth, size);
+	F.resize(size);
+	G.resize(size);
+	A.resize(depth, depth + 1);
+	gamma.resize(depth);
+}
+
+void AndersonMixing::next(double *x, const double *g)
+{
+	size_t i, j, k, pivot;
+	double f, tmp, scale;
+
+	if (!depth) {
+		__MEMCPY(x, g, size);
+		return;
+	}
+
+	if (started) {
+		double *_dF = dF[position];
+		double *_dG = dG[position];
+
+		for (i = 0; i < size; i++) {
+			f = g[i] - x[i];
+			_dF[i] = f - F[i];
+			_dG[i] = g[i] - G[i];
+			F[i] = f;
+			G[i] = g[i];
+		}
+
+		position = (position + 1) % depth;
+		if (count < depth) count++;
+	}
+	else {
+		for (i = 0; i < size; i++) {
+			F[i] = g[i] - x[i];
+			G[i] = g[i];
+		}
+
+		started = true;
+	}
+
+	if (!count) {
+		__MEMCPY(x, g, size);
+		return;
+	}
+
+	/* min |F - dF^T gamma| via the normal equations, which are tiny */
+	scale = 0;
+	for (i = 0; i < count; i++) {
+		for (j = i; j < count; j++) {
+			tmp = 0;
+			for (k = 0; k < size; k++) tmp += dF[i][k] * dF[j][k];
+			A[i][j] = A[j][i] = tmp;
+		}
+
+		tmp = 0;
+		for (k = 0; k < size; k++) tmp += dF[i][k] * F[k];
+		A[i][count] = tmp;
+
+		if (scale < A[i][i]) scale = A[i][i];
+	}
+
+	/* Gaussian elimination with partial pivoting */
+	for (i = 0; i < count; i++) {
+		pivot = i;
+		for (j = i + 1; j < count; j++)
+			if (std::abs(A[j][i]) > std::abs(A[pivot][i])) pivot = j;
+
+		/* The differences are (nearly) linearly dependent,
+		 * start over with the plain iteration.
+		 */
+		if (std::abs(A[pivot][i]) <= 1e-12 * scale) {
+			count = 0;
+			position = 0;
+			__MEMCPY(x, g, size);
+			return;
+		}
+
+		if (pivot != i)
+			for (k = i; k <= count; k++)
+				std::swap(A[i][k], A[pivot][k]);
+
+		for (j = i + 1; j < count; j++) {
+			tmp = A[j][i] / A[i][i];
+			for (k = i; k <= count; k++) A[j][k] -= tmp * A[i][k];
+		}
+	}
+
+	for (i = count; i-- > 0;) {
+		tmp = A[i][count];
+		for (j = i + 1; j < count; j++) tmp -= A[i][j] * gamma[j];
+		gamma[i] = tmp / A[i][i];
+	}
+
+	__MEMCPY(x, g, size);
+
+	for (i = 0; i < count; i++) {
+		const double *_dG = dG[i];
+		for (k = 0; k < size; k++) x[k] -= gamma[i] * _dG[k];
+	}
+}
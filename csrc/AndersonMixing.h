@@ -0,0 +1,53 @@
+#ifndef __ANDERSON_MIXING_H__
+#define __ANDERSON_MIXING_H__
+
+#include "common.h"
+
+/* Accelerates a fixed-point iteration x = g(x) by combining the last
+ * depth iterates in the way that minimizes the residual f = g(x) - x
+ * in the least-squares sense (the so-called Anderson mixing).
+ * The depth of zero gives the plain fixed-point iteration.
+ */
+class AndersonMixing
+{
+	size_t depth;
+
+	size_t size;
+
+	/* The number of the stored differences and where the next one goes */
+	size_t count, position;
+	bool started;
+
+	/* The differences of the residuals and of the images */
+	matrix_t dF;
+	matrix_t dG;
+
+	/* The residual and the image of the previous iteration */
+	vector_t F;
+	vector_t G;
+
+	/* The normal equations of the least-squares problem */
+	matrix_t A;
+	vector_t gamma;
+
+	public:
+
+	AndersonMixing(size_t _depth = 0);
+
+	inline size_t get_depth() const
+	{
+		return depth;
+	}
+
+	/* NOTE: forgets the history, should be called before each new
+	 * fixed-point problem of the given size.
+	 */
+	void reset(size_t _size);
+
+	/* Replaces the current iterate x with the next one given
+	 * its image g = g(x).
+	 */
+	void next(double *x, const double *g);
+};
+
+#endif
@@ -59,6 +59,92 @@ void DynamicPower::compute(const Schedule &schedule, matrix_t &_dynamic_power) c
 	}
 }
 
+void DynamicPower::compute(const Schedule &schedule,
+	PowerSegments &segments) const
+{
+	pid_t pid;
+
+	size_t i, j, task_count, start, end;
+	const Processor *processor;
+	double power;
+
+	/* The boundaries of the segments are the steps where some task
+	 * starts or finishes, which gives exactly the same profile as
+	 * the dense one above, but without repetitions.
+	 */
+	std::vector<size_t> boundaries;
+
+	boundaries.push_back(0);
+	boundaries.push_back(step_count);
+
+	for (pid = 0; pid < processor_count; pid++) {
+		const LocalSchedule &local_schedule = schedule[pid];
+		task_count = local_schedule.size();
+
+		for (i = 0; i < task_count; i++) {
+			const ScheduleItem &item = local_schedule[i];
+
+			start = STEP_NUMBER(item.start, sampling_interval);
+			end = STEP_NUMBER(item.start + item.duration, sampling_interval);
+
+			boundaries.push_back(std::min(start, step_count));
+			boundaries.push_back(std::min(end, step_count));
+		}
+	}
+
+	std::sort(boundaries.begin(), boundaries.end());
+	boundaries.erase(std::unique(boundaries.begin(), boundaries.end()),
+		boundaries.end());
+
+	size_t segment_count = boundaries.size() - 1;
+
+	segments.lengths.resize(segment_count);
+	for (i = 0; i < segment_count; i++)
+		segments.lengths[i] = boundaries[i + 1] - boundaries[i];
+
+	segments.power.resize(segment_count, processor_count);
+	segments.power.nullify();
+
+	std::vector<size_t>::iterator first = boundaries.begin();
+
+	for (pid = 0; pid < processor_count; pid++) {
+		const LocalSchedule &local_schedule = schedule[pid];
+		task_count = local_schedule.size();
+		processor = processors[pid];
+
+		for (i = 0; i < task_count; i++) {
+			const ScheduleItem &item = local_schedule[i];
+
+			start = STEP_NUMBER(item.start, sampling_interval);
+			end = STEP_NUMBER(item.start + item.duration, sampling_interval);
+			end = std::min(end, step_count);
+
+			if (start >= end) continue;
+
+			power = processor->calc_power(types[item.id]);
+
+			j = std::lower_bound(first, boundaries.end(), start) - first;
+
+			for (; boundaries[j] < end; j++)
+				segments.power[j][pid] = power;
+		}
+	}
+}
+
+void PowerSegments::expand(matrix_t &profile) const
+{
+	size_t processor_count = power.cols();
+	size_t segment_count = lengths.size();
+
+	profile.resize(steps(), processor_count);
+
+	size_t i, j, k;
+
+	for (i = 0, k = 0; i < segment_count; i++)
+		for (j = 0; j < lengths[i]; j++, k++)
+			__MEMCPY(profile[k], power[i], processor_count);
+}
+
 CoarseDynamicPower::CoarseDynamicPower(const processor_vector_t &_processors,
 	const task_vector_t &tasks, double _deadline) :
 
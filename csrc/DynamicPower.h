@@ -1,7 +1,36 @@
 #ifndef __DYNAMIC_POWER_H__
+#define __DYNAMIC_POWER_H__
 
 #include "common.h"
 
+/* Run-length encoded power profile: the power of the i-th segment
+ * (the i-th row of the matrix) stays constant during lengths[i] steps.
+ */
+struct PowerSegments
+{
+	std::vector<size_t> lengths;
+	matrix_t power;
+
+	inline size_t size() const
+	{
+		return lengths.size();
+	}
+
+	inline size_t steps() const
+	{
+		size_t step_count = 0;
+		size_t segment_count = lengths.size();
+
+		for (size_t i = 0; i < segment_count; i++)
+			step_count += lengths[i];
+
+		return step_count;
+	}
+
+	/* Unfold into the (step_count x processor_count) profile */
+	void expand(matrix_t &profile) const;
+};
+
 class DynamicPower
 {
 	const processor_vector_t &processors;
@@ -17,6 +46,7 @@ class DynamicPower
 		const task_vector_t &tasks, double deadline, double sampling_interval);
 
 	void compute(const Schedule &schedule, matrix_t &_dynamic_power) const;
+	void compute(const Schedule &schedule, PowerSegments &segments) const;
 };
 
 class CoarseDynamicPower
@@ -8,24 +8,134 @@
 
 price_t Evaluation::process(const Schedule &schedule)
 {
-	evaluations++;
+	price_t price = process(schedule, workspace);
+	collect(workspace);
+
+	return price;
+}
+
+void Evaluation::process(const std::vector<const Schedule *> &schedules,
+	std::vector<price_t> &prices)
+{
+	process(schedules, prices, workspace);
+	collect(workspace);
+}
+
+bool Evaluation::reentrant() const
+{
+	return hotspot.reentrant();
+}
+
+price_t Evaluation::process(const Schedule &schedule,
+	EvaluationWorkspace &workspace) const
+{
+	workspace.evaluations++;
 
 	double difference = graph.get_deadline() - schedule.get_duration();
 
 	if (difference < 0) {
-		deadline_misses++;
+		workspace.deadline_misses++;
 		return price_t(difference, DBL_MAX);
 	}
 
-	return compute(schedule);
+	return compute(schedule, workspace);
 }
 
-price_t Evaluation::compute(const Schedule &schedule)
+void Evaluation::process(const std::vector<const Schedule *> &schedules,
+	std::vector<price_t> &prices, EvaluationWorkspace &workspace) const
 {
-	double sampling_interval = hotspot.get_sampling_interval();
+	size_t i, j, count = schedules.size();
+
+	workspace.evaluations += count;
 
+	prices.resize(count);
+
+	std::vector<const Schedule *> feasible;
+	std::vector<size_t> index;
+
+	for (i = 0; i < count; i++) {
+		double difference = graph.get_deadline() - schedules[i]->get_duration();
+
+		if (difference < 0) {
+			workspace.deadline_misses++;
+			prices[i] = price_t(difference, DBL_MAX);
+		}
+		else {
+			feasible.push_back(schedules[i]);
+			index.push_back(i);
+		}
+	}
+
+	if (feasible.empty()) return;
+
+	std::vector<price_t> feasible_prices;
+	compute(feasible, feasible_prices, workspace);
+
+	for (j = 0; j < index.size(); j++)
+		prices[index[j]] = feasible_prices[j];
+}
+
+void Evaluation::collect(EvaluationWorkspace &workspace)
+{
+	evaluations += workspace.evaluations;
+	deadline_misses += workspace.deadline_misses;
+	temperature_runaways += workspace.temperature_runaways;
+	cache_hits += workspace.cache_hits;
+
+	workspace.evaluations = 0;
+	workspace.deadline_misses = 0;
+	workspace.temperature_runaways = 0;
+	workspace.cache_hits = 0;
+}
+
+price_t Evaluation::compute(const Schedule &schedule,
+	EvaluationWorkspace &workspace) const
+{
 	matrix_t temperature, power;
-	hotspot.solve(schedule, temperature, power);
+	solve(schedule, temperature, power, workspace.solver);
+
+	return assess(temperature, power, workspace.lifetime,
+		workspace.temperature_runaways);
+}
+
+void Evaluation::compute(const std::vector<const Schedule *> &schedules,
+	std::vector<price_t> &prices, EvaluationWorkspace &workspace) const
+{
+	size_t count = schedules.size();
+
+	std::vector<matrix_t> temperature, power;
+	solve(schedules, temperature, power, workspace.solver);
+
+	prices.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+		prices[i] = assess(temperature[i], power[i], workspace.lifetime,
+			workspace.temperature_runaways);
+}
+
+void Evaluation::solve(const Schedule &schedule, matrix_t &temperature,
+	matrix_t &power, SolverWorkspace &workspace) const
+{
+	if (hotspot.reentrant())
+		hotspot.solve(schedule, temperature, power, workspace);
+	else
+		hotspot.solve(schedule, temperature, power);
+}
+
+void Evaluation::solve(const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+	SolverWorkspace &workspace) const
+{
+	if (hotspot.reentrant())
+		hotspot.solve_batch(schedules, temperature, power, workspace);
+	else
+		hotspot.solve_batch(schedules, temperature, power);
+}
+
+price_t Evaluation::assess(const matrix_t &temperature, const matrix_t &power,
+	LifetimeWorkspace &workspace, size_t &temperature_runaways) const
+{
+	double sampling_interval = hotspot.get_sampling_interval();
 
 	if (max_temperature > 0) {
 		size_t total_count = temperature.size();
@@ -38,7 +148,8 @@ price_t Evaluation::compute(const Schedule &schedule)
 			}
 	}
 
-	double lifetime = this->lifetime.predict(temperature, sampling_interval);
+	double lifetime = this->lifetime.predict(temperature,
+		sampling_interval, workspace);
 	double energy = 0;
 
 	if (!shallow) {
@@ -70,9 +181,98 @@ std::ostream &operator<<(std::ostream &o, const Evaluation &e)
 	return o;
 }
 
+price_t CachedEvaluation::compute(const Schedule &schedule,
+	EvaluationWorkspace &workspace) const
+{
+	FitnessCache::key_t key = this->key(schedule);
+
+	price_t price;
+
+	if (recall(key, price)) {
+		workspace.cache_hits++;
+		return price;
+	}
+
+	price = Evaluation::compute(schedule, workspace);
+	remember(key, price);
+
+	return price;
+}
+
+void CachedEvaluation::compute(const std::vector<const Schedule *> &schedules,
+	std::vector<price_t> &prices, EvaluationWorkspace &workspace) const
+{
+	std::vector<const Schedule *> missed;
+	std::vector<size_t> index;
+
+	workspace.cache_hits += recall(schedules, prices, missed, index);
+
+	if (missed.empty()) return;
+
+	std::vector<price_t> missed_prices;
+	Evaluation::compute(missed, missed_prices, workspace);
+
+	remember(missed, missed_prices, index, prices);
+}
+
+FitnessCache::key_t CachedEvaluation::key(const Schedule &schedule) const
+{
+	return FitnessCache::key_t(&schedule.trace[0],
+		sizeof(step_t) * schedule.trace_length, get_shallow());
+}
+
+bool CachedEvaluation::recall(const FitnessCache::key_t &key,
+	price_t &price) const
+{
+	if (cache.recall(key, price)) return true;
+
+	if (!store || !store->recall(key, price)) return false;
+
+	cache.remember(key, price);
+
+	return true;
+}
+
+void CachedEvaluation::remember(const FitnessCache::key_t &key,
+	const price_t &price) const
+{
+	cache.remember(key, price);
+	if (store) store->remember(key, price);
+}
+
+size_t CachedEvaluation::recall(const std::vector<const Schedule *> &schedules,
+	std::vector<price_t> &prices, std::vector<const Schedule *> &missed,
+	std::vector<size_t> &index) const
+{
+	size_t i, hits = 0, count = schedules.size();
+
+	prices.resize(count);
+
+	for (i = 0; i < count; i++) {
+		if (recall(key(*schedules[i]), prices[i])) hits++;
+		else {
+			missed.push_back(schedules[i]);
+			index.push_back(i);
+		}
+	}
+
+	return hits;
+}
+
+void CachedEvaluation::remember(const std::vector<const Schedule *> &missed,
+	const std::vector<price_t> &missed_prices,
+	const std::vector<size_t> &index, std::vector<price_t> &prices) const
+{
+	for (size_t j = 0; j < index.size(); j++) {
+		prices[index[j]] = missed_prices[j];
+		remember(key(*missed[j]), missed_prices[j]);
+	}
+}
+
 #ifndef WITHOUT_MEMCACHED
 
-price_t MemcachedEvaluation::compute(const Schedule &schedule)
+price_t MemcachedEvaluation::compute(const Schedule &schedule,
+	EvaluationWorkspace &workspace) const
 {
 	Digest digest((const unsigned char *)&schedule.trace[0],
 		sizeof(step_t) * (extended ? schedule.trace_length : schedule.task_count));
@@ -80,26 +280,68 @@ price_t MemcachedEvaluation::compute(const Schedule &schedule)
 	price_t price, *value;
 
 	if ((value = recall(digest))) {
-		cache_hits++;
+		workspace.cache_hits++;
 
 		price = *value;
 		free(value);
 
 #ifdef VERIFY_CACHING
-		price_t real_price = Evaluation::compute(schedule);
+		price_t real_price = Evaluation::compute(schedule, workspace);
 		if (price != real_price)
 			throw std::runtime_error("The caching is broken.");
 #endif
 	}
 	else {
-		price = Evaluation::compute(schedule);
+		price = Evaluation::compute(schedule, workspace);
 		remember(digest, price);
 	}
 
 	return price;
 }
 
-price_t *MemcachedEvaluation::recall(const Digest &key)
+void MemcachedEvaluation::compute(const std::vector<const Schedule *> &schedules,
+	std::vector<price_t> &prices, EvaluationWorkspace &workspace) const
+{
+	size_t i, j, count = schedules.size();
+
+	prices.resize(count);
+
+	std::vector<Digest> digests;
+	std::vector<const Schedule *> missed;
+	std::vector<size_t> index;
+
+	price_t *value;
+
+	for (i = 0; i < count; i++) {
+		const Schedule &schedule = *schedules[i];
+
+		Digest digest((const unsigned char *)&schedule.trace[0],
+			sizeof(step_t) * (extended ? schedule.trace_length : schedule.task_count));
+
+		if ((value = recall(digest))) {
+			workspace.cache_hits++;
+			prices[i] = *value;
+			free(value);
+		}
+		else {
+			digests.push_back(digest);
+			missed.push_back(schedules[i]);
+			index.push_back(i);
+		}
+	}
+
+	if (missed.empty()) return;
+
+	std::vector<price_t> missed_prices;
+	Evaluation::compute(missed, missed_prices, workspace);
+
+	for (j = 0; j < index.size(); j++) {
+		prices[index[j]] = missed_prices[j];
+		remember(digests[j], missed_prices[j]);
+	}
+}
+
+price_t *MemcachedEvaluation::recall(const Digest &key) const
 {
 	char *value;
 	size_t read;
@@ -117,7 +359,8 @@ price_t *MemcachedEvaluation::recall(const Digest &key)
 	return (price_t *)value;
 }
 
-void MemcachedEvaluation::remember(const Digest &key, const price_t &price)
+void MemcachedEvaluation::remember(const Digest &key,
+	const price_t &price) const
 {
 	memcached_return_t rc;
 
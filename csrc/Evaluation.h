@@ -4,6 +4,9 @@
 #include "common.h"
 #include "Genetics.h"
 #include "Lifetime.h"
+#include "AnalyticalSolution.h"
+#include "FitnessCache.h"
+#include "FitnessStore.h"
 
 #ifndef WITHOUT_MEMCACHED
 #include <libmemcached/memcached.h>
@@ -11,6 +14,24 @@
 #include <sstream>
 #endif
 
+/* Everything that changes while evaluating, one per thread, the counters
+ * are added to the ones of the evaluation by collect().
+ */
+struct EvaluationWorkspace
+{
+	SolverWorkspace solver;
+	LifetimeWorkspace lifetime;
+
+	size_t evaluations;
+	size_t deadline_misses;
+	size_t temperature_runaways;
+	size_t cache_hits;
+
+	EvaluationWorkspace() :
+		evaluations(0), deadline_misses(0), temperature_runaways(0),
+		cache_hits(0) {}
+};
+
 class Evaluation
 {
 	ThermalCyclingLifetime lifetime;
@@ -22,6 +43,9 @@ class Evaluation
 	double max_temperature;
 	bool shallow;
 
+	/* For the entry points without a workspace */
+	EvaluationWorkspace workspace;
+
 	public:
 
 	size_t evaluations;
@@ -37,13 +61,38 @@ class Evaluation
 		evaluations(0), deadline_misses(0),
 		temperature_runaways(0), cache_hits(0) {}
 
+	virtual ~Evaluation() {}
+
+	/* The same as the constant versions below with the workspace of
+	 * the evaluation itself.
+	 */
 	price_t process(const Schedule &schedule);
+	void process(const std::vector<const Schedule *> &schedules,
+		std::vector<price_t> &prices);
+
+	/* Whether the constant versions below can be called by several
+	 * threads at once, each with a workspace of its own.
+	 */
+	virtual bool reentrant() const;
+
+	price_t process(const Schedule &schedule,
+		EvaluationWorkspace &workspace) const;
+	void process(const std::vector<const Schedule *> &schedules,
+		std::vector<price_t> &prices, EvaluationWorkspace &workspace) const;
+
+	/* Takes over the counters of the workspace and resets them */
+	void collect(EvaluationWorkspace &workspace);
 
 	inline void set_shallow(bool shallow)
 	{
 		this->shallow = shallow;
 	}
 
+	inline bool get_shallow() const
+	{
+		return shallow;
+	}
+
 	inline void reset()
 	{
 		evaluations = 0;
@@ -54,11 +103,86 @@ class Evaluation
 
 	protected:
 
-	virtual price_t compute(const Schedule &schedule);
+	virtual price_t compute(const Schedule &schedule,
+		EvaluationWorkspace &workspace) const;
+	virtual void compute(const std::vector<const Schedule *> &schedules,
+		std::vector<price_t> &prices, EvaluationWorkspace &workspace) const;
+
+	price_t assess(const matrix_t &temperature, const matrix_t &power,
+		LifetimeWorkspace &workspace, size_t &temperature_runaways) const;
+
+	private:
+
+	/* The constant solution of the hotspot if it has one,
+	 * otherwise the plain one, which is not reentrant.
+	 */
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
+	void solve(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+		SolverWorkspace &workspace) const;
 };
 
 std::ostream &operator<<(std::ostream &o, const Evaluation &e);
 
+/* Keeps the prices in the memory of the process and, optionally, behind
+ * it in a store on the disk. Both can be shared by several threads, hence,
+ * the evaluation stays reentrant. The key is the whole trace, i.e., both
+ * the order and the mapping.
+ */
+class CachedEvaluation: public Evaluation
+{
+	mutable FitnessCache cache;
+	FitnessStore *store;
+
+	public:
+
+	/* NOTE: capacity is in bytes, the store is optional */
+	CachedEvaluation(size_t capacity, FitnessStore *_store,
+		const Architecture &_architecture, const Graph &_graph,
+		Hotspot &_hotspot, double _max_temperature = 0, bool _shallow = false) :
+
+		Evaluation(_architecture, _graph, _hotspot, _max_temperature, _shallow),
+		cache(capacity), store(_store) {}
+
+	inline const FitnessCache &get_cache() const
+	{
+		return cache;
+	}
+
+	protected:
+
+	price_t compute(const Schedule &schedule,
+		EvaluationWorkspace &workspace) const;
+	void compute(const std::vector<const Schedule *> &schedules,
+		std::vector<price_t> &prices, EvaluationWorkspace &workspace) const;
+
+	private:
+
+	/* The energy is not computed in the shallow mode, hence,
+	 * such prices are kept apart.
+	 */
+	FitnessCache::key_t key(const Schedule &schedule) const;
+
+	/* The memory first, then the store, which refills the memory */
+	bool recall(const FitnessCache::key_t &key, price_t &price) const;
+	void remember(const FitnessCache::key_t &key, const price_t &price) const;
+
+	/* Fills in the prices of the cached schedules, returns the number
+	 * of them, and collects the rest.
+	 */
+	size_t recall(const std::vector<const Schedule *> &schedules,
+		std::vector<price_t> &prices, std::vector<const Schedule *> &missed,
+		std::vector<size_t> &index) const;
+
+	/* Puts the prices of the missed schedules in the cache and
+	 * in their places given by index.
+	 */
+	void remember(const std::vector<const Schedule *> &missed,
+		const std::vector<price_t> &missed_prices,
+		const std::vector<size_t> &index, std::vector<price_t> &prices) const;
+};
+
 #ifndef WITHOUT_MEMCACHED
 
 class MemcachedEvaluation: public Evaluation
@@ -104,12 +228,21 @@ class MemcachedEvaluation: public Evaluation
 		memcached_free(memcache);
 	}
 
+	/* The connection to the server is not shared */
+	bool reentrant() const
+	{
+		return false;
+	}
+
 	protected:
 
-	price_t compute(const Schedule &schedule);
+	price_t compute(const Schedule &schedule,
+		EvaluationWorkspace &workspace) const;
+	void compute(const std::vector<const Schedule *> &schedules,
+		std::vector<price_t> &prices, EvaluationWorkspace &workspace) const;
 
-	price_t *recall(const Digest &key);
-	void remember(const Digest &key, const price_t &price);
+	price_t *recall(const Digest &key) const;
+	void remember(const Digest &key, const price_t &price) const;
 };
 
 #endif
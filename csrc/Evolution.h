@@ -16,6 +16,7 @@
 
 #include "ListScheduler.h"
 #include "Evaluation.h"
+#include "ThreadPool.h"
 
 template<class CT>
 class eslabCheckPoint;
@@ -48,6 +49,29 @@ class Evolution: public BasicEvolution
 
 	const size_t chromosome_length;
 
+	/* What a thread needs to schedule and evaluate chromosomes,
+	 * all kept from one chromosome or batch to another.
+	 */
+	struct workspace_t
+	{
+		SchedulerWorkspace scheduler;
+		EvaluationWorkspace evaluation;
+
+		layout_t layout;
+		priority_t priority;
+		std::vector<Schedule> schedules;
+
+		inline Schedule *prepare(size_t count)
+		{
+			if (schedules.size() < count) schedules.resize(count);
+			return &schedules[0];
+		}
+	};
+
+	/* The threads evaluating populations, each with a workspace */
+	ThreadPool pool;
+	std::vector<workspace_t> workspaces;
+
 	public:
 
 	typedef CT chromosome_t;
@@ -64,7 +88,8 @@ class Evolution: public BasicEvolution
 		scheduler(_scheduler), evaluation(_evaluation),
 		tuning(_tuning), constrains(_constrains),
 		chromosome_length((constrains.fixed_layout() ? 1 : 2) * graph.size()),
-		stats(_evaluation)
+		pool(tuning.optimization.evaluation_threads),
+		workspaces(pool.size()), stats(_evaluation)
 	{
 		if (chromosome_length == 0)
 			throw std::runtime_error("The length cannot be zero.");
@@ -98,6 +123,53 @@ class Evolution: public BasicEvolution
 
 	protected:
 
+	/* The same as above, but without allocations once the workspace
+	 * has seen a chromosome of the problem. With checkpoints, the list
+	 * scheduler starts from where the chromosome this one was copied from
+	 * was scheduled the same way, and the chromosome keeps its own trail,
+	 * which is the same one if nobody else holds it.
+	 */
+	inline void schedule(chromosome_t &chromosome, Schedule &schedule,
+		workspace_t &workspace) const
+	{
+		const layout_t *layout = &constrains.layout;
+		const priority_t *priority = &chromosome;
+
+		if (!constrains.fixed_layout()) {
+			GeneEncoder::split(chromosome, workspace.priority, workspace.layout);
+			layout = &workspace.layout;
+			priority = &workspace.priority;
+		}
+
+		const size_t interval = tuning.optimization.checkpoint_interval;
+
+		if (interval == 0) {
+			scheduler.process_into(*layout, *priority, schedule,
+				workspace.scheduler);
+			return;
+		}
+
+		ScheduleTrail *previous = chromosome.trail;
+		ScheduleTrail *trail = ScheduleTrail::unique(previous) ?
+			previous : ScheduleTrail::create(interval);
+
+		try {
+			scheduler.process_into(*layout, *priority, schedule,
+				workspace.scheduler, previous, trail);
+		}
+		catch (...) {
+			/* Written over only in part */
+			if (trail == previous) chromosome.trail = NULL;
+			ScheduleTrail::release(trail);
+			throw;
+		}
+
+		if (trail == previous) return;
+
+		ScheduleTrail::release(previous);
+		chromosome.trail = trail;
+	}
+
 #ifdef PRECISE_TIMEOUT
 	bool populate(population_t &population, const layout_t &layout,
 		const priority_t &priority, const Continuation<CT> &continuation);
@@ -110,26 +182,194 @@ class Evolution: public BasicEvolution
 	{
 		if (!chromosome.invalid()) return;
 
-		price_t price;
+		workspace_t &workspace = workspaces[0];
+		Schedule &schedule = *workspace.prepare(1);
 
-		if (constrains.fixed_layout()) {
-			Schedule schedule = scheduler.process(constrains.layout, chromosome);
-			price = evaluation.process(schedule);
+		this->schedule(chromosome, schedule, workspace);
+		chromosome.set_price(evaluation.process(schedule));
+	}
+
+	/* All the invalid chromosomes at once, so that the thermal
+	 * analysis can process them as one batch.
+	 */
+	inline void evaluate(eoPop<chromosome_t> &population)
+	{
+		size_t i, count;
+
+		std::vector<chromosome_t *> chromosomes;
+		invalid(population, chromosomes);
+
+		count = chromosomes.size();
+
+		if (count == 0) return;
+
+		if (parallel()) {
+			/* The batch solution is the same for every profile
+			 * regardless of the others in the batch, hence, the chunks
+			 * give what the whole population would.
+			 */
+			evaluate_job_t job(*this, chromosomes,
+				(count + 4 * pool.size() - 1) / (4 * pool.size()), false);
+			run(job);
+			return;
 		}
-		else {
-			layout_t layout;
-			priority_t priority;
 
-			GeneEncoder::split(chromosome, priority, layout);
+		workspace_t &workspace = workspaces[0];
+		Schedule *schedules = workspace.prepare(count);
+
+		std::vector<const Schedule *> batch(count);
+
+		for (i = 0; i < count; i++) {
+			schedule(*chromosomes[i], schedules[i], workspace);
+			batch[i] = &schedules[i];
+		}
+
+		std::vector<price_t> prices;
+		evaluation.process(batch, prices);
+
+		for (i = 0; i < count; i++)
+			chromosomes[i]->set_price(prices[i]);
+	}
+
+#ifdef PRECISE_TIMEOUT
+	/* One by one while there is time, returns false if some of
+	 * the chromosomes are left invalid.
+	 */
+	inline bool evaluate(eoPop<chromosome_t> &population,
+		const eslabCheckPoint<chromosome_t> &checkpoint)
+	{
+		size_t i, count;
+
+		std::vector<chromosome_t *> chromosomes;
+		invalid(population, chromosomes);
+
+		count = chromosomes.size();
 
-			Schedule schedule = scheduler.process(layout, priority);
-			price = evaluation.process(schedule);
+		if (parallel()) {
+			evaluate_job_t job(*this, chromosomes, 1, true);
+			job.checkpoint = &checkpoint;
+			return run(job);
 		}
 
-		chromosome.set_price(price);
+		for (i = 0; i < count; i++) {
+			if (checkpoint.timeout()) return false;
+			evaluate(*chromosomes[i]);
+		}
+
+		return true;
+	}
+#endif
+
+	inline bool parallel() const
+	{
+		return pool.size() > 1 && evaluation.reentrant();
 	}
 
 	stats_t stats;
+
+	private:
+
+	/* Schedules and evaluates chunks of the given length of
+	 * the chromosomes on the threads of the pool. Each chunk goes through
+	 * the batch solution unless single, then the chromosomes of the chunk
+	 * are solved one by one as in evaluate(chromosome).
+	 */
+	class evaluate_job_t: public ThreadPool::Job
+	{
+		public:
+
+		evaluate_job_t(Evolution &_evolution,
+			const std::vector<chromosome_t *> &_chromosomes,
+			size_t _length, bool _single) :
+
+			evolution(_evolution), chromosomes(_chromosomes),
+			length(_length), single(_single)
+#ifdef PRECISE_TIMEOUT
+			, checkpoint(NULL)
+#endif
+			{}
+
+		inline size_t size() const
+		{
+			return (chromosomes.size() + length - 1) / length;
+		}
+
+		void process(size_t item, size_t worker)
+		{
+			size_t i;
+
+			const size_t first = item * length;
+			const size_t count = std::min(length, chromosomes.size() - first);
+
+			workspace_t &workspace = evolution.workspaces[worker];
+
+			if (single) {
+				Schedule &schedule = *workspace.prepare(1);
+
+				for (i = first; i < first + count; i++) {
+					evolution.schedule(*chromosomes[i], schedule, workspace);
+					chromosomes[i]->set_price(evolution.evaluation.process(
+						schedule, workspace.evaluation));
+				}
+				return;
+			}
+
+			Schedule *schedules = workspace.prepare(count);
+			std::vector<const Schedule *> batch(count);
+
+			for (i = 0; i < count; i++) {
+				evolution.schedule(*chromosomes[first + i], schedules[i],
+					workspace);
+				batch[i] = &schedules[i];
+			}
+
+			std::vector<price_t> prices;
+			evolution.evaluation.process(batch, prices, workspace.evaluation);
+
+			for (i = 0; i < count; i++)
+				chromosomes[first + i]->set_price(prices[i]);
+		}
+
+#ifdef PRECISE_TIMEOUT
+		bool stop() const
+		{
+			return checkpoint && checkpoint->timeout();
+		}
+#endif
+
+		private:
+
+		Evolution &evolution;
+		const std::vector<chromosome_t *> &chromosomes;
+		const size_t length;
+		const bool single;
+
+#ifdef PRECISE_TIMEOUT
+		public:
+
+		const eslabCheckPoint<chromosome_t> *checkpoint;
+#endif
+	};
+
+	inline void invalid(eoPop<chromosome_t> &population,
+		std::vector<chromosome_t *> &chromosomes) const
+	{
+		size_t count = population.size();
+
+		for (size_t i = 0; i < count; i++)
+			if (population[i].invalid())
+				chromosomes.push_back(&population[i]);
+	}
+
+	inline bool run(evaluate_job_t &job)
+	{
+		bool done = pool.run(job, job.size());
+
+		for (size_t i = 0; i < workspaces.size(); i++)
+			evaluation.collect(workspaces[i].evaluation);
+
+		return done;
+	}
 };
 
 /******************************************************************************/
@@ -197,6 +437,21 @@ class eslabCheckPoint: public eoContinue<CT>
 	std::vector<eoMonitor *> monitors;
 };
 
+/* A population evaluation that can be interrupted by the checkpoint */
+template<class CT>
+class eslabPopEvalFunc: public eoPopEvalFunc<CT>
+{
+	public:
+
+#ifdef PRECISE_TIMEOUT
+	/* Returns false if the time is up before all the chromosomes
+	 * are evaluated.
+	 */
+	virtual bool operator()(eoPop<CT> &population,
+		const eslabCheckPoint<CT> &checkpoint) = 0;
+#endif
+};
+
 template<class CT>
 class eslabEvolutionMonitor: public eoMonitor
 {
@@ -0,0 +1,187 @@
+#include "FitnessCache.h"
+
+/* The finalizer of MurmurHash3 */
+static inline uint64_t mix(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return key;
+}
+
+static inline uint64_t rotate(uint64_t key, int shift)
+{
+	return (key << shift) | (key >> (64 - shift));
+}
+
+FitnessCache::key_t::key_t(const void *_data, size_t _size, size_t _tag) :
+	data(_data), size(_size), tag(_tag)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+
+	uint64_t h1 = 0x9e3779b97f4a7c15ULL ^ size;
+	uint64_t h2 = 0xc2b2ae3d27d4eb4fULL ^ tag;
+	uint64_t word;
+
+	size_t i;
+
+	/* Two lanes over the words, each lane feeds the other */
+	for (i = 0; i + sizeof(word) <= size; i += sizeof(word)) {
+		memcpy(&word, bytes + i, sizeof(word));
+
+		h1 = rotate(h1 ^ mix(word), 27) * 0x87c37b91114253d5ULL + h2;
+		h2 = rotate(h2 + word, 31) * 0x4cf5ad432745937fULL ^ h1;
+	}
+
+	if (i < size) {
+		word = 0;
+		memcpy(&word, bytes + i, size - i);
+
+		h1 = rotate(h1 ^ mix(word), 27) * 0x87c37b91114253d5ULL + h2;
+		h2 = rotate(h2 + word, 31) * 0x4cf5ad432745937fULL ^ h1;
+	}
+
+	hash[0] = mix(h1 + h2);
+	hash[1] = mix(h2 ^ hash[0]);
+}
+
+FitnessCache::FitnessCache(size_t _capacity) :
+	capacity(_capacity / FITNESS_CACHE_SHARDS)
+{
+	for (size_t i = 0; i < FITNESS_CACHE_SHARDS; i++) {
+		pthread_mutex_init(&shards[i].mutex, NULL);
+		shards[i].usage = 0;
+		shards[i].hits = 0;
+		shards[i].misses = 0;
+		shards[i].evictions = 0;
+	}
+}
+
+FitnessCache::~FitnessCache()
+{
+	for (size_t i = 0; i < FITNESS_CACHE_SHARDS; i++)
+		pthread_mutex_destroy(&shards[i].mutex);
+}
+
+bool FitnessCache::recall(const key_t &key, price_t &price)
+{
+	shard_t &shard = this->shard(key);
+
+	pthread_mutex_lock(&shard.mutex);
+
+	entries_t::iterator it = find(shard, key);
+	bool found = it != shard.entries.end();
+
+	if (found) {
+		/* Move to the front as the most recently used */
+		if (it != shard.entries.begin())
+			shard.entries.splice(shard.entries.begin(), shard.entries, it);
+
+		price = it->price;
+		shard.hits++;
+	}
+	else shard.misses++;
+
+	pthread_mutex_unlock(&shard.mutex);
+
+	return found;
+}
+
+void FitnessCache::remember(const key_t &key, const price_t &price)
+{
+	shard_t &shard = this->shard(key);
+
+	const size_t size = usage(key.size);
+
+	if (size > capacity) return;
+
+	pthread_mutex_lock(&shard.mutex);
+
+	/* Somebody else might have been faster */
+	if (find(shard, key) != shard.entries.end()) {
+		pthread_mutex_unlock(&shard.mutex);
+		return;
+	}
+
+	/* Evict the least recently used ones */
+	while (shard.usage + size > capacity) {
+		entry_t &last = shard.entries.back();
+
+		std::pair<index_t::iterator, index_t::iterator> range =
+			shard.index.equal_range(last.hash);
+
+		for (index_t::iterator it = range.first; it != range.second; it++)
+			if (&*it->second == &last) {
+				shard.index.erase(it);
+				break;
+			}
+
+		shard.usage -= usage(last.data.size());
+		shard.entries.pop_back();
+		shard.evictions++;
+	}
+
+	shard.entries.push_front(entry_t());
+
+	entry_t &entry = shard.entries.front();
+	entry.hash = hash_t(key.hash[0], key.hash[1]);
+	entry.tag = key.tag;
+	entry.data.assign((const char *)key.data, key.size);
+	entry.price = price;
+
+	shard.index.insert(index_t::value_type(entry.hash,
+		shard.entries.begin()));
+	shard.usage += size;
+
+	pthread_mutex_unlock(&shard.mutex);
+}
+
+size_t FitnessCache::get_hits() const
+{
+	size_t hits = 0;
+
+	for (size_t i = 0; i < FITNESS_CACHE_SHARDS; i++)
+		hits += shards[i].hits;
+
+	return hits;
+}
+
+size_t FitnessCache::get_misses() const
+{
+	size_t misses = 0;
+
+	for (size_t i = 0; i < FITNESS_CACHE_SHARDS; i++)
+		misses += shards[i].misses;
+
+	return misses;
+}
+
+size_t FitnessCache::get_evictions() const
+{
+	size_t evictions = 0;
+
+	for (size_t i = 0; i < FITNESS_CACHE_SHARDS; i++)
+		evictions += shards[i].evictions;
+
+	return evictions;
+}
+
+FitnessCache::entries_t::iterator FitnessCache::find(shard_t &shard,
+	const key_t &key)
+{
+	std::pair<index_t::iterator, index_t::iterator> range =
+		shard.index.equal_range(hash_t(key.hash[0], key.hash[1]));
+
+	for (index_t::iterator it = range.first; it != range.second; it++) {
+		const entry_t &entry = *it->second;
+
+		if (entry.tag == key.tag && entry.data.size() == key.size &&
+			!memcmp(entry.data.data(), key.data, key.size))
+			return it->second;
+	}
+
+	return shard.entries.end();
+}
@@ -0,0 +1,98 @@
+#ifndef __FITNESS_CACHE_H__
+#define __FITNESS_CACHE_H__
+
+#include "common.h"
+
+#include <map>
+#include <stdint.h>
+#include <pthread.h>
+
+#define FITNESS_CACHE_SHARDS 16
+
+/* Keeps the prices of the recently evaluated schedules in the memory.
+ * The entries are spread over independently locked shards by a 128-bit
+ * hash of the key, so that several threads rarely wait for each other,
+ * and each shard evicts its least recently used entries once it grows
+ * over its part of the memory bound. The hash only finds an entry,
+ * the whole key is compared before the price is given out.
+ */
+class FitnessCache
+{
+	public:
+
+	/* A key with its hash computed once for both recall and remember.
+	 * The tag distinguishes the prices of the same data computed
+	 * differently, for instance, with and without the energy.
+	 */
+	struct key_t
+	{
+		const void *data;
+		size_t size;
+		size_t tag;
+
+		uint64_t hash[2];
+
+		key_t(const void *_data, size_t _size, size_t _tag = 0);
+	};
+
+	/* NOTE: capacity is in bytes */
+	FitnessCache(size_t capacity);
+	~FitnessCache();
+
+	bool recall(const key_t &key, price_t &price);
+	void remember(const key_t &key, const price_t &price);
+
+	size_t get_hits() const;
+	size_t get_misses() const;
+	size_t get_evictions() const;
+
+	private:
+
+	typedef std::pair<uint64_t, uint64_t> hash_t;
+
+	struct entry_t
+	{
+		hash_t hash;
+		size_t tag;
+		std::string data;
+		price_t price;
+	};
+
+	typedef std::list<entry_t> entries_t;
+	typedef std::multimap<hash_t, entries_t::iterator> index_t;
+
+	struct shard_t
+	{
+		pthread_mutex_t mutex;
+
+		/* The most recently used go first */
+		entries_t entries;
+		index_t index;
+
+		size_t usage;
+
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+	};
+
+	const size_t capacity;
+	shard_t shards[FITNESS_CACHE_SHARDS];
+
+	FitnessCache(const FitnessCache &);
+
+	inline shard_t &shard(const key_t &key)
+	{
+		return shards[key.hash[1] % FITNESS_CACHE_SHARDS];
+	}
+
+	/* The memory an entry takes including the bookkeeping */
+	static inline size_t usage(size_t size)
+	{
+		return size + sizeof(entry_t) + 8 * sizeof(void *);
+	}
+
+	entries_t::iterator find(shard_t &shard, const key_t &key);
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include <sstream>
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FitnessStore.h"
+
+#define FITNESS_STORE_VERSION 1
+#define FITNESS_STORE_CAPACITY 4096
+
+#define SLOT_FULL 1
+
+struct FitnessStore::header_t
+{
+	char magic[8];
+	uint64_t version;
+	uint64_t identity;
+	uint64_t key_size;
+	uint64_t capacity;
+	uint64_t count;
+};
+
+/* The key follows the slot */
+struct FitnessStore::slot_t
+{
+	uint64_t hash[2];
+	uint32_t state;
+	uint32_t tag;
+	double lifetime;
+	double energy;
+};
+
+/* FNV-1a */
+static uint64_t digest(uint64_t key, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+
+	for (size_t i = 0; i < size; i++) {
+		key ^= bytes[i];
+		key *= 1099511628211ULL;
+	}
+
+	return key;
+}
+
+FitnessStore::FitnessStore(const std::string &directory,
+	const std::string &_identity, size_t _key_size) :
+
+	key_size(_key_size),
+	slot_size(sizeof(slot_t) + (key_size + 7) / 8 * 8),
+	identity(0), file(-1), writer(false), data(NULL), length(0)
+{
+	pthread_rwlock_init(&lock, NULL);
+
+	if (directory.empty()) return;
+
+	uint64_t size = key_size;
+
+	identity = digest(14695981039346656037ULL,
+		_identity.data(), _identity.size());
+	identity = digest(identity, &size, sizeof(size));
+
+	std::stringstream stream;
+	stream << directory << "/" << std::hex << std::setw(16)
+		<< std::setfill('0') << identity << ".fitness";
+
+	filename = stream.str();
+
+	file = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if (file < 0)
+		throw std::runtime_error("Cannot open the fitness store.");
+
+	/* Whoever comes first writes, the rest only read */
+	writer = !flock(file, LOCK_EX | LOCK_NB);
+
+	if (writer) {
+		if (!map(file, true) &&
+			(!create(file, FITNESS_STORE_CAPACITY) || !map(file, true)))
+			throw std::runtime_error("Cannot create the fitness store.");
+	}
+	else if (!map(file, false)) {
+		close(file);
+		file = -1;
+	}
+}
+
+FitnessStore::~FitnessStore()
+{
+	if (data) munmap(data, length);
+	if (file >= 0) close(file);
+
+	pthread_rwlock_destroy(&lock);
+}
+
+bool FitnessStore::recall(const FitnessCache::key_t &key, price_t &price)
+{
+	if (!data || key.size != key_size) return false;
+
+	pthread_rwlock_rdlock(&lock);
+
+	bool found;
+	slot_t *slot = find(key, found);
+
+	if (found) {
+		price.lifetime = slot->lifetime;
+		price.energy = slot->energy;
+	}
+
+	pthread_rwlock_unlock(&lock);
+
+	return found;
+}
+
+void FitnessStore::remember(const FitnessCache::key_t &key,
+	const price_t &price)
+{
+	if (!data || !writer || key.size != key_size) return;
+
+	pthread_rwlock_wrlock(&lock);
+
+	/* At most half full to keep the probing short */
+	if (2 * (header()->count + 1) > header()->capacity) grow();
+
+	bool found;
+	slot_t *slot = find(key, found);
+
+	if (slot && !found) {
+		slot->hash[0] = key.hash[0];
+		slot->hash[1] = key.hash[1];
+		slot->tag = key.tag;
+		slot->lifetime = price.lifetime;
+		slot->energy = price.energy;
+		memcpy(slot + 1, key.data, key_size);
+
+		/* Everything above is in place before the slot is seen */
+		__sync_synchronize();
+
+		slot->state = SLOT_FULL;
+		header()->count++;
+	}
+
+	pthread_rwlock_unlock(&lock);
+}
+
+size_t FitnessStore::size() const
+{
+	return data ? header()->count : 0;
+}
+
+FitnessStore::slot_t *FitnessStore::slot(void *data, size_t index) const
+{
+	return (slot_t *)((char *)data + sizeof(header_t) + index * slot_size);
+}
+
+bool FitnessStore::map(int file, bool write)
+{
+	struct stat info;
+
+	if (fstat(file, &info) || (size_t)info.st_size < sizeof(header_t))
+		return false;
+
+	size_t length = info.st_size;
+
+	void *data = mmap(NULL, length, PROT_READ | (write ? PROT_WRITE : 0),
+		MAP_SHARED, file, 0);
+
+	if (data == MAP_FAILED) return false;
+
+	const header_t *header = (const header_t *)data;
+	const size_t capacity = header->capacity;
+
+	if (memcmp(header->magic, "SDTAFIT", 8) ||
+		header->version != FITNESS_STORE_VERSION ||
+		header->identity != identity || header->key_size != key_size ||
+		capacity == 0 || (capacity & (capacity - 1)) ||
+		length != sizeof(header_t) + capacity * slot_size) {
+
+		munmap(data, length);
+		return false;
+	}
+
+	this->data = data;
+	this->length = length;
+
+	return true;
+}
+
+bool FitnessStore::create(int file, size_t capacity) const
+{
+	header_t header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SDTAFIT", 8);
+	header.version = FITNESS_STORE_VERSION;
+	header.identity = identity;
+	header.key_size = key_size;
+	header.capacity = capacity;
+	header.count = 0;
+
+	/* The slots are zeros, i.e., empty */
+	return
+		!ftruncate(file, 0) &&
+		!ftruncate(file, sizeof(header_t) + capacity * slot_size) &&
+		pwrite(file, &header, sizeof(header), 0) == sizeof(header);
+}
+
+void FitnessStore::grow()
+{
+	size_t i;
+
+	std::stringstream stream;
+	stream << filename << "." << getpid() << ".tmp";
+
+	std::string temporary = stream.str();
+
+	int next = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (next < 0)
+		throw std::runtime_error("Cannot grow the fitness store.");
+
+	void *previous_data = data;
+	size_t previous_length = length;
+	size_t previous_capacity = header()->capacity;
+
+	if (flock(next, LOCK_EX) || !create(next, 2 * previous_capacity) ||
+		!map(next, true)) {
+
+		close(next);
+		unlink(temporary.c_str());
+		throw std::runtime_error("Cannot grow the fitness store.");
+	}
+
+	for (i = 0; i < previous_capacity; i++) {
+		const slot_t *entry = slot(previous_data, i);
+		if (entry->state != SLOT_FULL) continue;
+
+		FitnessCache::key_t key(entry + 1, key_size, entry->tag);
+
+		bool found;
+		slot_t *slot = find(key, found);
+
+		memcpy(slot, entry, slot_size);
+		header()->count++;
+	}
+
+	/* The readers keep the previous file until they reopen */
+	if (rename(temporary.c_str(), filename.c_str())) {
+		munmap(data, length);
+		close(next);
+		unlink(temporary.c_str());
+
+		data = previous_data;
+		length = previous_length;
+
+		throw std::runtime_error("Cannot grow the fitness store.");
+	}
+
+	munmap(previous_data, previous_length);
+	close(file);
+
+	file = next;
+}
+
+FitnessStore::slot_t *FitnessStore::find(const FitnessCache::key_t &key,
+	bool &found) const
+{
+	const size_t capacity = header()->capacity;
+	const size_t mask = capacity - 1;
+
+	found = false;
+
+	for (size_t i = 0; i < capacity; i++) {
+		slot_t *slot = this->slot(data, (key.hash[0] + i) & mask);
+
+		uint32_t state = slot->state;
+
+		/* Nothing of the slot is read before its state */
+		__sync_synchronize();
+
+		if (state != SLOT_FULL) return slot;
+
+		if (slot->hash[0] == key.hash[0] && slot->hash[1] == key.hash[1] &&
+			slot->tag == key.tag && !memcmp(slot + 1, key.data, key_size)) {
+
+			found = true;
+			return slot;
+		}
+	}
+
+	return NULL;
+}
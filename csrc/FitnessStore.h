@@ -0,0 +1,97 @@
+#ifndef __FITNESS_STORE_H__
+#define __FITNESS_STORE_H__
+
+#include "common.h"
+#include "FitnessCache.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* Keeps the prices on the disk, so that they are reused by the repeated
+ * runs on the same problem. The file is named after a hash of everything
+ * the prices depend on, given as the identity, hence, a change of
+ * the system, the floorplan, the thermal model, or the solution never
+ * reuses stale entries.
+ *
+ * The file is an open-addressing hash table mapped to the memory.
+ * The first process to open it becomes the only writer, the others
+ * only read. The entries are never changed once written, and an entry
+ * is marked as complete only after its key and price are in place,
+ * thus, the readers never see a half-written one. When the table gets
+ * too full, the writer builds a twice bigger copy next to it and
+ * renames it over the old one, the readers keep the old mapping.
+ */
+class FitnessStore
+{
+	public:
+
+	/* NOTE: an empty directory disables the store */
+	FitnessStore(const std::string &directory, const std::string &_identity,
+		size_t _key_size);
+	~FitnessStore();
+
+	inline bool enabled() const
+	{
+		return data != NULL;
+	}
+
+	inline bool writable() const
+	{
+		return writer;
+	}
+
+	bool recall(const FitnessCache::key_t &key, price_t &price);
+	void remember(const FitnessCache::key_t &key, const price_t &price);
+
+	inline const std::string &get_filename() const
+	{
+		return filename;
+	}
+
+	size_t size() const;
+
+	private:
+
+	struct header_t;
+	struct slot_t;
+
+	const size_t key_size;
+	const size_t slot_size;
+
+	uint64_t identity;
+
+	std::string filename;
+
+	int file;
+	bool writer;
+
+	void *data;
+	size_t length;
+
+	pthread_rwlock_t lock;
+
+	FitnessStore(const FitnessStore &);
+
+	inline header_t *header() const
+	{
+		return (header_t *)data;
+	}
+
+	slot_t *slot(void *data, size_t index) const;
+
+	/* Maps the file, returns false if it is not a valid table */
+	bool map(int file, bool write);
+
+	/* Creates an empty table of the given capacity in the file */
+	bool create(int file, size_t capacity) const;
+
+	/* Moves the entries to a table twice as big */
+	void grow();
+
+	/* Finds the slot of the key or the empty slot where it should go,
+	 * NULL if the table is full.
+	 */
+	slot_t *find(const FitnessCache::key_t &key, bool &found) const;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include <ga/eoBitOp.h>
 
 #include "Schedule.h"
+#include "ScheduleTrail.h"
 
 class Chromosome
 {
@@ -49,8 +50,32 @@ class eslabChromosome
 
 	price_t price;
 
+	/* How the chromosome was scheduled, NULL if it was not */
+	ScheduleTrail *trail;
+
 	public:
 
+	eslabChromosome() : trail(NULL) {}
+
+	eslabChromosome(const eslabChromosome &another) :
+		price(another.price), trail(ScheduleTrail::acquire(another.trail)) {}
+
+	virtual ~eslabChromosome()
+	{
+		ScheduleTrail::release(trail);
+	}
+
+	inline eslabChromosome &operator=(const eslabChromosome &another)
+	{
+		ScheduleTrail *previous = trail;
+
+		price = another.price;
+		trail = ScheduleTrail::acquire(another.trail);
+		ScheduleTrail::release(previous);
+
+		return *this;
+	}
+
 	inline void set_price(const price_t &price)
 	{
 		this->price = price;
@@ -1,4 +1,5 @@
 #include <sstream>
+#include <map>
 
 #include "Processor.h"
 #include "Architecture.h"
@@ -41,8 +42,21 @@ size_t read_config_line(str_pair *table, size_t max, const std::string &line)
 	return count;
 }
 
+/* The slope function of the grid model, dT/dt = f(T, P), is not
+ * declared in the headers of HotSpot.
+ */
+extern "C" void slope_fn_grid(grid_model_t *model, double *v,
+	grid_model_vector_t *p, double *dv);
+
+std::string grid_config_line(const std::string &line)
+{
+	if (line.empty()) return "model_type grid";
+	return line + " model_type grid";
+}
+
 Hotspot::Hotspot(const std::string &floorplan_filename,
-	const std::string &config_filename, const std::string &config_line)
+	const std::string &config_filename, const std::string &config_line) :
+	iterations(0), error_bound(0)
 {
 	config = default_thermal_config();
 
@@ -76,7 +90,15 @@ Hotspot::Hotspot(const std::string &floorplan_filename,
 	model_time = Time::substract(&end, &begin);
 #endif
 
-	node_count = model->block->n_nodes;
+	if (model->type == BLOCK_MODEL)
+		node_count = model->block->n_nodes;
+	else {
+		grid_model_t *grid = model->grid;
+		node_count = grid->n_layers * grid->rows * grid->cols +
+			(grid->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA);
+	}
+
+	state_count = node_count;
 	processor_count = floorplan->n_units;
 
 	sampling_interval = config.sampling_intvl;
@@ -125,17 +147,22 @@ void Hotspot::get_inversed_capacitance(vector_t &inversed_capacitance) const
 CondensedEquationHotspot::CondensedEquationHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line) :
+	const std::string &config_line, size_t thread_count,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count, sampling_interval, ambient_temperature,
-		(const double **)model->block->b, model->block->a),
+		(const double **)model->block->b, model->block->a, thread_count,
+		reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
 void CondensedEquationHotspot::solve(
@@ -152,22 +179,87 @@ void CondensedEquationHotspot::solve(const Schedule &schedule,
 	solve(power, temperature);
 }
 
+void CondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &power, SolverWorkspace &workspace) const
+{
+	dynamic_power.compute(schedule, power);
+	temperature.resize(power);
+	equation.solve(power, temperature, power.rows(), workspace);
+}
+
+void CondensedEquationHotspot::solve_batch(
+	const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &power)
+{
+	std::vector<const double *> _power;
+	std::vector<double *> _temperature;
+
+	prepare(schedules, temperature, power, _power, _temperature);
+
+	if (schedules.empty()) return;
+
+	equation.solve(_power, _temperature, power[0].rows());
+}
+
+void CondensedEquationHotspot::solve_batch(
+	const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+	SolverWorkspace &workspace) const
+{
+	std::vector<const double *> _power;
+	std::vector<double *> _temperature;
+
+	prepare(schedules, temperature, power, _power, _temperature);
+
+	if (schedules.empty()) return;
+
+	equation.solve(_power, _temperature, power[0].rows(), workspace);
+}
+
+void CondensedEquationHotspot::prepare(
+	const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+	std::vector<const double *> &_power,
+	std::vector<double *> &_temperature) const
+{
+	size_t count = schedules.size();
+
+	temperature.resize(count);
+	power.resize(count);
+
+	_power.resize(count);
+	_temperature.resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		dynamic_power.compute(*schedules[i], power[i]);
+		temperature[i].resize(power[i]);
+		_power[i] = power[i];
+		_temperature[i] = temperature[i];
+	}
+}
+
 /******************************************************************************/
 
 LeakageCondensedEquationHotspot::LeakageCondensedEquationHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line, const Leakage &leakage) :
+	const std::string &config_line, const Leakage &leakage,
+	size_t history,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count, sampling_interval,
-		ambient_temperature, model->block->b, model->block->a, leakage),
+		ambient_temperature, model->block->b, model->block->a, leakage,
+		history, reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
 void LeakageCondensedEquationHotspot::solve(const matrix_t &dynamic_power,
@@ -175,10 +267,219 @@ void LeakageCondensedEquationHotspot::solve(const matrix_t &dynamic_power,
 {
 	temperature.resize(dynamic_power);
 	total_power.resize(dynamic_power);
-	equation.solve(dynamic_power, temperature, total_power, dynamic_power.rows());
+	iterations = equation.solve(dynamic_power, temperature, total_power,
+		dynamic_power.rows());
+}
+
+void LeakageCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &total_power)
+{
+	matrix_t power;
+	dynamic_power.compute(schedule, power);
+	solve(power, temperature, total_power);
 }
 
 void LeakageCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &total_power,
+	SolverWorkspace &workspace) const
+{
+	matrix_t power;
+	dynamic_power.compute(schedule, power);
+	temperature.resize(power);
+	total_power.resize(power);
+	workspace.iterations = equation.solve(power, temperature, total_power,
+		power.rows(), workspace);
+}
+
+void LeakageCondensedEquationHotspot::solve_batch(
+	const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &total_power)
+{
+	std::vector<matrix_t> power;
+
+	std::vector<const double *> _power;
+	std::vector<double *> _temperature;
+	std::vector<double *> _total_power;
+
+	prepare(schedules, temperature, total_power, power,
+		_power, _temperature, _total_power);
+
+	if (schedules.empty()) return;
+
+	iterations = equation.solve(_power, _temperature, _total_power,
+		power[0].rows());
+}
+
+void LeakageCondensedEquationHotspot::solve_batch(
+	const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &total_power,
+	SolverWorkspace &workspace) const
+{
+	std::vector<matrix_t> power;
+
+	std::vector<const double *> _power;
+	std::vector<double *> _temperature;
+	std::vector<double *> _total_power;
+
+	prepare(schedules, temperature, total_power, power,
+		_power, _temperature, _total_power);
+
+	if (schedules.empty()) return;
+
+	workspace.iterations = equation.solve(_power, _temperature,
+		_total_power, power[0].rows(), workspace);
+}
+
+void LeakageCondensedEquationHotspot::prepare(
+	const std::vector<const Schedule *> &schedules,
+	std::vector<matrix_t> &temperature, std::vector<matrix_t> &total_power,
+	std::vector<matrix_t> &power, std::vector<const double *> &_power,
+	std::vector<double *> &_temperature,
+	std::vector<double *> &_total_power) const
+{
+	size_t count = schedules.size();
+
+	temperature.resize(count);
+	total_power.resize(count);
+	power.resize(count);
+
+	_power.resize(count);
+	_temperature.resize(count);
+	_total_power.resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		dynamic_power.compute(*schedules[i], power[i]);
+		temperature[i].resize(power[i]);
+		total_power[i].resize(power[i]);
+		_power[i] = power[i];
+		_temperature[i] = temperature[i];
+		_total_power[i] = total_power[i];
+	}
+}
+
+/******************************************************************************/
+
+BandedCondensedEquationHotspot::BandedCondensedEquationHotspot(
+	const Architecture &architecture, const Graph &graph,
+	const std::string &floorplan, const std::string &config,
+	const std::string &config_line, const BandedLinearLeakage &leakage,
+	const reduction_t &reduction) :
+
+	Hotspot(floorplan, config, config_line),
+	equation(processor_count, node_count, sampling_interval,
+		ambient_temperature, (const double **)model->block->b,
+		model->block->a, leakage, reduction),
+	dynamic_power(architecture.get_processors(), graph.get_tasks(),
+		graph.get_deadline(), sampling_interval)
+{
+#ifdef MEASURE_TIME
+	/* The decompositions are done on demand */
+	decomposition_time = 0;
+#endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
+}
+
+void BandedCondensedEquationHotspot::solve(const matrix_t &dynamic_power,
+	matrix_t &temperature, matrix_t &total_power)
+{
+	temperature.resize(dynamic_power);
+	total_power.resize(dynamic_power);
+	iterations = equation.solve(dynamic_power, temperature, total_power,
+		dynamic_power.rows());
+
+	/* The bands met on the way might have brought new models */
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
+}
+
+void BandedCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &total_power)
+{
+	matrix_t power;
+	dynamic_power.compute(schedule, power);
+	solve(power, temperature, total_power);
+}
+
+/******************************************************************************/
+
+ModalCondensedEquationHotspot::ModalCondensedEquationHotspot(
+	const Architecture &architecture, const Graph &graph,
+	const std::string &floorplan, const std::string &config,
+	const std::string &config_line,
+	const reduction_t &reduction) :
+
+	Hotspot(floorplan, config, config_line),
+	equation(processor_count, node_count, sampling_interval, ambient_temperature,
+		(const double **)model->block->b, model->block->a, reduction),
+	dynamic_power(architecture.get_processors(), graph.get_tasks(),
+		graph.get_deadline(), sampling_interval)
+{
+#ifdef MEASURE_TIME
+	decomposition_time = equation.decomposition_time;
+#endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
+}
+
+void ModalCondensedEquationHotspot::solve(
+	const matrix_t &power, matrix_t &temperature)
+{
+	temperature.resize(power);
+	equation.solve(power, temperature, power.rows());
+}
+
+void ModalCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &power)
+{
+	dynamic_power.compute(schedule, power);
+	solve(power, temperature);
+}
+
+void ModalCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &power, SolverWorkspace &workspace) const
+{
+	dynamic_power.compute(schedule, power);
+	temperature.resize(power);
+	equation.solve(power, temperature, power.rows(), workspace);
+}
+
+/******************************************************************************/
+
+LeakageModalCondensedEquationHotspot::LeakageModalCondensedEquationHotspot(
+	const Architecture &architecture, const Graph &graph,
+	const std::string &floorplan, const std::string &config,
+	const std::string &config_line, const Leakage &leakage,
+	size_t history,
+	const reduction_t &reduction) :
+
+	Hotspot(floorplan, config, config_line),
+	equation(processor_count, node_count, sampling_interval,
+		ambient_temperature, model->block->b, model->block->a, leakage,
+		history, reduction),
+	dynamic_power(architecture.get_processors(), graph.get_tasks(),
+		graph.get_deadline(), sampling_interval)
+{
+#ifdef MEASURE_TIME
+	decomposition_time = equation.decomposition_time;
+#endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
+}
+
+void LeakageModalCondensedEquationHotspot::solve(const matrix_t &dynamic_power,
+	matrix_t &temperature, matrix_t &total_power)
+{
+	temperature.resize(dynamic_power);
+	total_power.resize(dynamic_power);
+	iterations = equation.solve(dynamic_power, temperature, total_power,
+		dynamic_power.rows());
+}
+
+void LeakageModalCondensedEquationHotspot::solve(const Schedule &schedule,
 	matrix_t &temperature, matrix_t &total_power)
 {
 	matrix_t power;
@@ -186,24 +487,41 @@ void LeakageCondensedEquationHotspot::solve(const Schedule &schedule,
 	solve(power, temperature, total_power);
 }
 
+void LeakageModalCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &total_power,
+	SolverWorkspace &workspace) const
+{
+	matrix_t power;
+	dynamic_power.compute(schedule, power);
+	temperature.resize(power);
+	total_power.resize(power);
+	workspace.iterations = equation.solve(power, temperature, total_power,
+		power.rows(), workspace);
+}
+
 /******************************************************************************/
 
 FixedCondensedEquationHotspot::FixedCondensedEquationHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line) :
+	const std::string &config_line, size_t thread_count,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count,
 		NUMBER_OF_STEPS(graph.get_deadline(), sampling_interval),
 		sampling_interval, ambient_temperature,
-		(const double **)model->block->b, model->block->a),
+		(const double **)model->block->b, model->block->a, thread_count,
+		reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
 void FixedCondensedEquationHotspot::solve(
@@ -220,24 +538,37 @@ void FixedCondensedEquationHotspot::solve(const Schedule &schedule,
 	solve(power, temperature);
 }
 
+void FixedCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &power, SolverWorkspace &workspace) const
+{
+	dynamic_power.compute(schedule, power);
+	temperature.resize(power);
+	equation.solve(power, temperature, power.rows(), workspace);
+}
+
 /******************************************************************************/
 
 LeakageFixedCondensedEquationHotspot::LeakageFixedCondensedEquationHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line, const Leakage &leakage) :
+	const std::string &config_line, const Leakage &leakage,
+	size_t history,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count,
 		NUMBER_OF_STEPS(graph.get_deadline(), sampling_interval),
 		sampling_interval, ambient_temperature,
-		model->block->b, model->block->a, leakage),
+		model->block->b, model->block->a, leakage, history, reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
 void LeakageFixedCondensedEquationHotspot::solve(const matrix_t &dynamic_power,
@@ -245,7 +576,8 @@ void LeakageFixedCondensedEquationHotspot::solve(const matrix_t &dynamic_power,
 {
 	temperature.resize(dynamic_power);
 	total_power.resize(dynamic_power);
-	equation.solve(dynamic_power, temperature, total_power, dynamic_power.rows());
+	iterations = equation.solve(dynamic_power, temperature, total_power,
+		dynamic_power.rows());
 }
 
 void LeakageFixedCondensedEquationHotspot::solve(const Schedule &schedule,
@@ -256,6 +588,18 @@ void LeakageFixedCondensedEquationHotspot::solve(const Schedule &schedule,
 	solve(power, temperature, total_power);
 }
 
+void LeakageFixedCondensedEquationHotspot::solve(const Schedule &schedule,
+	matrix_t &temperature, matrix_t &total_power,
+	SolverWorkspace &workspace) const
+{
+	matrix_t power;
+	dynamic_power.compute(schedule, power);
+	temperature.resize(power);
+	total_power.resize(power);
+	workspace.iterations = equation.solve(power, temperature, total_power,
+		power.rows(), workspace);
+}
+
 /******************************************************************************/
 
 CoarseCondensedEquationHotspot::CoarseCondensedEquationHotspot(
@@ -294,18 +638,273 @@ TransientAnalyticalHotspot::TransientAnalyticalHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
 	const std::string &config_line, size_t max_iterations,
-	double tolerance, bool warmup) :
+	double tolerance, bool warmup,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count, sampling_interval, ambient_temperature,
 		(const double **)model->block->b, model->block->a,
-		max_iterations, tolerance, warmup),
+		max_iterations, tolerance, warmup, reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
+}
+
+/******************************************************************************/
+
+KrylovGridHotspot::KrylovGridHotspot(
+	const Architecture &architecture, const Graph &graph,
+	const std::string &floorplan, const std::string &config,
+	const std::string &config_line, size_t krylov_dimension,
+	double tolerance) :
+
+	Hotspot(floorplan, config, grid_config_line(config_line)),
+	equation(processor_count, node_count, sampling_interval, ambient_temperature,
+		extract(model, processor_count), krylov_dimension, tolerance),
+	dynamic_power(architecture.get_processors(), graph.get_tasks(),
+		graph.get_deadline(), sampling_interval)
+{
+#ifdef MEASURE_TIME
+	decomposition_time = equation.decomposition_time;
+#endif
+}
+
+/* The slope function is dT/dt = C^(-1) * (P - G * (T - T_amb)), hence,
+ * with zero power, it gives the columns of -C^(-1) * G when it is probed
+ * with T_amb + e(j). The cells, the i-th row and the j-th column of
+ * the n-th layer, are connected only to the cells with the same i and j
+ * in the other layers, to their four neighbors in the same layer, and
+ * to the extra nodes of the package. Therefore, the cells of a layer
+ * that have i and j with the same residuals modulo 3 are probed at once,
+ * and every response in the cells is attributed to its only neighbor
+ * among the probed ones. The extra nodes are connected to whole sides
+ * of the layers, so they are probed one by one, and the rows of the extra
+ * nodes are filled in by symmetry. The capacitance of the extra nodes is
+ * recovered from the same symmetry, G(i, j) = G(j, i), for which
+ * the corners of the layers are probed one by one as well.
+ */
+SparseNetwork KrylovGridHotspot::extract(const RC_model_t *model,
+	size_t processor_count)
+{
+	size_t i, j, k, n, u;
+
+	grid_model_t *grid = model->grid;
+
+	const size_t nl = grid->n_layers;
+	const size_t nr = grid->rows;
+	const size_t nc = grid->cols;
+	const size_t cell_count = nl * nr * nc;
+	const size_t extra_count =
+		grid->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+	const size_t node_count = cell_count + extra_count;
+	const double ambient = grid->config.ambient;
+
+	if (grid->layers[0].flp->n_units != (int)processor_count)
+		throw std::runtime_error("The grid model does not match the floorplan.");
+
+	typedef std::map<size_t, double> row_t;
+	std::vector<row_t> A(node_count);
+
+	grid_model_vector_t *power = new_grid_model_vector(grid);
+	vector_t T(node_count), dT(node_count);
+
+	/* The cells */
+	for (n = 0; n < nl; n++)
+		for (size_t ri = 0; ri < 3; ri++)
+			for (size_t rj = 0; rj < 3; rj++) {
+				for (k = 0; k < node_count; k++) T[k] = ambient;
+				for (i = ri; i < nr; i += 3)
+					for (j = rj; j < nc; j += 3)
+						T[(n * nr + i) * nc + j] += 1;
+
+				slope_fn_grid(grid, T, power, dT);
+
+				for (k = 0; k < cell_count; k++) {
+					if (dT[k] == 0) continue;
+
+					size_t m = k / (nr * nc);
+					size_t ki = (k / nc) % nr;
+					size_t kj = k % nc;
+
+					/* The probed neighbor is either right above or below,
+					 * or among the five cells around in the same layer.
+					 */
+					if (m == n) {
+						if (ki % 3 == (ri + 1) % 3 && ki > 0) ki--;
+						else if (ki % 3 == (ri + 2) % 3 && ki + 1 < nr) ki++;
+						else if (kj % 3 == (rj + 1) % 3 && kj > 0) kj--;
+						else if (kj % 3 == (rj + 2) % 3 && kj + 1 < nc) kj++;
+					}
+
+					if (ki % 3 != ri || kj % 3 != rj)
+						throw std::runtime_error(
+							"The grid model has an unexpected structure.");
+
+					A[k][(n * nr + ki) * nc + kj] = dT[k];
+				}
+			}
+
+	/* The extra nodes */
+	for (u = 0; u < extra_count; u++) {
+		for (k = 0; k < node_count; k++) T[k] = ambient;
+		T[cell_count + u] += 1;
+
+		slope_fn_grid(grid, T, power, dT);
+
+		for (k = 0; k < node_count; k++)
+			if (dT[k] != 0) A[k][cell_count + u] = dT[k];
+	}
+
+	/* The corners for the extra nodes */
+	for (n = 0; n < nl; n++)
+		for (u = 0; u < 4; u++) {
+			i = (u / 2) * (nr - 1);
+			j = (u % 2) * (nc - 1);
+
+			size_t l = (n * nr + i) * nc + j;
+
+			for (k = 0; k < node_count; k++) T[k] = ambient;
+			T[l] += 1;
+
+			slope_fn_grid(grid, T, power, dT);
+
+			for (k = cell_count; k < node_count; k++)
+				if (dT[k] != 0) A[k][l] = dT[k];
+		}
+
+	SparseNetwork network;
+
+	/* The capacitance of the cells is known, and the rest is
+	 * C(i) = C(j) * A(j, i) / A(i, j) along the known pairs.
+	 */
+	vector_t &C = network.capacitance;
+	C.resize(node_count);
+
+	for (k = 0; k < cell_count; k++)
+		C[k] = grid->layers[k / (nr * nc)].c;
+	for (k = cell_count; k < node_count; k++)
+		C[k] = 0;
+
+	for (bool found = true; found;) {
+		found = false;
+
+		for (k = cell_count; k < node_count; k++) {
+			if (C[k] > 0) continue;
+
+			for (row_t::const_iterator it = A[k].begin();
+				it != A[k].end(); it++) {
+
+				if (it->first == k || C[it->first] == 0) continue;
+
+				row_t::const_iterator back = A[it->first].find(k);
+				if (back == A[it->first].end()) continue;
+
+				C[k] = C[it->first] * back->second / it->second;
+				found = true;
+				break;
+			}
+		}
+	}
+
+	for (k = cell_count; k < node_count; k++)
+		if (!(C[k] > 0))
+			throw std::runtime_error(
+				"Cannot recover the capacitance of the grid model.");
+
+	/* G = -C * A, and it is symmetric, so the rows of the extra nodes
+	 * get the cell columns from the columns of the extra nodes, and
+	 * the rest is averaged to cancel the round-off.
+	 */
+	std::vector<row_t> G(node_count);
+
+	for (k = 0; k < node_count; k++)
+		for (row_t::const_iterator it = A[k].begin(); it != A[k].end(); it++)
+			G[k][it->first] = -C[k] * it->second;
+
+	for (k = 0; k < cell_count; k++)
+		for (row_t::const_iterator it = G[k].lower_bound(cell_count);
+			it != G[k].end(); it++)
+			G[it->first][k] = it->second;
+
+	sparse_matrix_t &conductance = network.conductance;
+	conductance.resize(node_count, node_count);
+
+	for (k = 0; k < node_count; k++) {
+		for (row_t::const_iterator it = G[k].begin(); it != G[k].end(); it++) {
+			row_t::const_iterator back = G[it->first].find(k);
+			if (back == G[it->first].end())
+				throw std::runtime_error(
+					"The grid model has an unexpected structure.");
+			conductance.append(it->first, (it->second + back->second) / 2);
+		}
+		conductance.next_row();
+	}
+
+	/* The power is distributed over the cells by the area */
+	double *block = hotspot_vector_grid(grid);
+	size_t block_count = grid->total_n_blocks + extra_count;
+
+	sparse_matrix_t &distribution = network.distribution;
+	distribution.resize(processor_count, node_count);
+
+	for (u = 0; u < processor_count; u++) {
+		for (k = 0; k < block_count; k++) block[k] = 0;
+		block[u] = 1;
+
+		xlate_vector_b2g(grid, block, power, V_POWER);
+
+		double *P = power->cuboid[0][0];
+		for (k = 0; k < node_count; k++)
+			if (P[k] != 0) distribution.append(k, P[k]);
+		distribution.next_row();
+	}
+
+	free_dvector(block);
+	free_grid_model_vector(power);
+
+	/* The temperature of a processor is the average over the cells
+	 * that it covers, or over the central ones.
+	 */
+	sparse_matrix_t &observation = network.observation;
+	observation.resize(processor_count, node_count);
+
+	for (u = 0; u < processor_count; u++) {
+		const glist_t &box = grid->layers[0].g2bmap[u];
+		row_t row;
+
+		if (grid->map_mode == GRID_CENTER) {
+			size_t ci1 = (box.i1 + box.i2) / 2;
+			size_t cj1 = (box.j1 + box.j2) / 2;
+			size_t ci2 = ci1 - !((box.i2 - box.i1) % 2);
+			size_t cj2 = cj1 - !((box.j2 - box.j1) % 2);
+
+			row[ci1 * nc + cj1] += 0.25;
+			row[ci2 * nc + cj1] += 0.25;
+			row[ci1 * nc + cj2] += 0.25;
+			row[ci2 * nc + cj2] += 0.25;
+		}
+		else if (grid->map_mode == GRID_AVG) {
+			double weight = 1.0 / ((box.i2 - box.i1) * (box.j2 - box.j1));
+
+			for (i = box.i1; i < (size_t)box.i2; i++)
+				for (j = box.j1; j < (size_t)box.j2; j++)
+					row[i * nc + j] += weight;
+		}
+		else throw std::runtime_error(
+			"The grid mapping mode is not supported.");
+
+		for (row_t::const_iterator it = row.begin(); it != row.end(); it++)
+			observation.append(it->first, it->second);
+		observation.next_row();
+	}
+
+	return network;
 }
 
 /******************************************************************************/
@@ -313,20 +912,20 @@ TransientAnalyticalHotspot::TransientAnalyticalHotspot(
 BasicSteadyStateHotspot::BasicSteadyStateHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line) :
+	const std::string &config_line, size_t cache_size) :
 
 	Hotspot(floorplan, config, config_line),
 	processors(architecture.get_processors()),
 	deadline(graph.get_deadline()),
-	step_count(NUMBER_OF_STEPS(deadline, sampling_interval)), storage(NULL)
+	step_count(NUMBER_OF_STEPS(deadline, sampling_interval)),
+	type_count(processors[0]->size()),
+	cache(processor_count, type_count, cache_size)
 {
 #ifndef SHALLOW_CHECK
 	if (step_count == 0)
 		throw std::runtime_error("The number of steps is zero.");
 #endif
 
-	type_count = processors[0]->size();
-
 #ifndef SHALLOW_CHECK
 	for (size_t i = 1; i < processor_count; i++)
 		if (type_count != processors[i]->size())
@@ -339,17 +938,10 @@ BasicSteadyStateHotspot::BasicSteadyStateHotspot(
 	types.resize(task_count);
 	for (size_t i = 0; i < task_count; i++)
 		types[i] = tasks[i]->get_type();
-
-	storage = new Slot(type_count);
-}
-
-BasicSteadyStateHotspot::~BasicSteadyStateHotspot()
-{
-	__DELETE(storage);
 }
 
 void BasicSteadyStateHotspot::solve(const Schedule &schedule,
-	matrix_t &temperature, matrix_t &power)
+	matrix_t &temperature, matrix_t &power, SolverWorkspace &workspace) const
 {
 	temperature.resize(step_count, processor_count);
 	power.resize(step_count, processor_count);
@@ -361,6 +953,8 @@ void BasicSteadyStateHotspot::solve(const Schedule &schedule,
 	size_t i, start = 0, end;
 
 	SlotTrace trace(processor_count, -1);
+	SlotCache::key_t key;
+	vector_t slot_temperature(processor_count);
 
 	while (queue.next(event)) {
 		end = STEP_NUMBER(event.time, sampling_interval);
@@ -371,7 +965,15 @@ void BasicSteadyStateHotspot::solve(const Schedule &schedule,
 #endif
 
 		if (end != start) {
-			const double *slot_temperature = get(trace);
+			cache.pack(trace, key);
+
+			/* Several threads might compute the same slot at once,
+			 * but the result is the same.
+			 */
+			if (!cache.recall(key, slot_temperature)) {
+				compute(trace, slot_temperature, workspace);
+				cache.remember(key, slot_temperature);
+			}
 
 			for (i = start; i < end && i < step_count; i++)
 				__MEMCPY(temperature[i], slot_temperature, processor_count);
@@ -390,81 +992,77 @@ void BasicSteadyStateHotspot::solve(const Schedule &schedule,
 	}
 }
 
-const double *BasicSteadyStateHotspot::get(const SlotTrace &trace)
-{
-	Slot *slot = storage->find(trace);
-
-	double *power = slot->get_data();
-
-	if (!power) {
-		power = compute(trace);
-		slot->store(power);
-	}
-
-	return power;
-}
-
 SteadyStateHotspot::SteadyStateHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line) :
+	const std::string &config_line, size_t cache_size,
+	const reduction_t &reduction) :
 
-	BasicSteadyStateHotspot(architecture, graph, floorplan, config, config_line),
+	BasicSteadyStateHotspot(architecture, graph, floorplan, config,
+		config_line, cache_size),
 	equation(processor_count, node_count, sampling_interval,
-		ambient_temperature, (const double **)model->block->b, model->block->a)
+		ambient_temperature, (const double **)model->block->b, model->block->a,
+		reduction)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
-double *SteadyStateHotspot::compute(const SlotTrace &trace)
+void SteadyStateHotspot::compute(const SlotTrace &trace,
+	double *temperature, SolverWorkspace &workspace) const
 {
-	double *power = __ALLOC(node_count);
-	double *temperature = __ALLOC(node_count);
+	matrix_t &power = workspace.P;
 
-	__NULLIFY(power, node_count);
+	power.resize(1, processor_count);
+	power.nullify();
 
 	for (size_t i = 0; i < processor_count; i++) {
 		if (trace[i] < 0) continue;
-		power[i] = processors[i]->calc_power((unsigned int)trace[i]);
+		power[0][i] = processors[i]->calc_power((unsigned int)trace[i]);
 	}
 
-	equation.solve(power, temperature);
-
-	__FREE(power);
-
-	return temperature;
+	equation.solve(power, temperature, 1, workspace);
 }
 
 LeakageSteadyStateHotspot::LeakageSteadyStateHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line, const Leakage &_leakage) :
+	const std::string &config_line, const Leakage &_leakage,
+	size_t history, size_t cache_size,
+	const reduction_t &reduction) :
 
-	BasicSteadyStateHotspot(architecture, graph, floorplan, config, config_line),
+	BasicSteadyStateHotspot(architecture, graph, floorplan, config,
+		config_line, cache_size),
 	equation(processor_count, node_count, sampling_interval, ambient_temperature,
-		model->block->b, model->block->a, _leakage)
+		model->block->b, model->block->a, _leakage, history, reduction)
 {
-	dynamic_power.resize(node_count);
-	total_power.resize(node_count);
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
-double *LeakageSteadyStateHotspot::compute(const SlotTrace &trace)
+void LeakageSteadyStateHotspot::compute(const SlotTrace &trace,
+	double *temperature, SolverWorkspace &workspace) const
 {
-	double *temperature = __ALLOC(node_count);
+	matrix_t &dynamic_power = workspace.P;
+	matrix_t &total_power = workspace.leakage_power;
+
+	dynamic_power.resize(1, processor_count);
+	total_power.resize(1, processor_count);
 
 	for (size_t i = 0; i < processor_count; i++) {
-		if (trace[i] < 0) dynamic_power[i] = 0;
-		else dynamic_power[i] = processors[i]->calc_power((unsigned int)trace[i]);
+		if (trace[i] < 0) dynamic_power[0][i] = 0;
+		else dynamic_power[0][i] = processors[i]->calc_power((unsigned int)trace[i]);
 	}
 
-	(void)equation.solve(dynamic_power, temperature, total_power);
-
-	return temperature;
+	(void)equation.solve(dynamic_power, temperature, total_power, 1, workspace);
 }
 
 /******************************************************************************/
@@ -472,17 +1070,22 @@ double *LeakageSteadyStateHotspot::compute(const SlotTrace &trace)
 PreciseSteadyStateHotspot::PreciseSteadyStateHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
-	const std::string &config_line, bool one_step) :
+	const std::string &config_line, bool one_step,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count, sampling_interval,
-		ambient_temperature, (const double **)model->block->b, model->block->a),
+		ambient_temperature, (const double **)model->block->b, model->block->a,
+		reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		one_step ? sampling_interval : graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
 /******************************************************************************/
@@ -491,17 +1094,21 @@ LeakagePreciseSteadyStateHotspot::LeakagePreciseSteadyStateHotspot(
 	const Architecture &architecture, const Graph &graph,
 	const std::string &floorplan, const std::string &config,
 	const std::string &config_line, const Leakage &_leakage,
-	bool one_step) :
+	size_t history, bool one_step,
+	const reduction_t &reduction) :
 
 	Hotspot(floorplan, config, config_line),
 	equation(processor_count, node_count, sampling_interval, ambient_temperature,
-		model->block->b, model->block->a, _leakage),
+		model->block->b, model->block->a, _leakage, history, reduction),
 	dynamic_power(architecture.get_processors(), graph.get_tasks(),
 		one_step ? sampling_interval : graph.get_deadline(), sampling_interval)
 {
 #ifdef MEASURE_TIME
 	decomposition_time = equation.decomposition_time;
 #endif
+
+	state_count = equation.get_state_count();
+	error_bound = equation.get_error_bound();
 }
 
 /******************************************************************************/
@@ -741,7 +1348,8 @@ void LeakageIterativeHotspot::solve(const matrix_t &dynamic_power,
 	matrix_t extended_total_power(step_count, node_count);
 	double *_extended_total_power = extended_total_power;
 
-	(void)solve(_dynamic_power, _temperature, _extended_total_power, step_count);
+	iterations = solve(_dynamic_power, _temperature,
+		_extended_total_power, step_count);
 
 	for (size_t i = 0; i < step_count; i++)
 		__MEMCPY(_total_power + i * processor_count,
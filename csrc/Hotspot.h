@@ -6,11 +6,14 @@ extern "C" {
 #include <hotspot/flp.h>
 #include <hotspot/temperature.h>
 #include <hotspot/temperature_block.h>
+#include <hotspot/temperature_grid.h>
 }
 
 #include "Leakage.h"
 #include "DynamicPower.h"
 #include "AnalyticalSolution.h"
+#include "KrylovSolution.h"
+#include "SlotCache.h"
 
 class Hotspot
 {
@@ -33,6 +36,15 @@ class Hotspot
 	flp_t *floorplan;
 	RC_model_t *model;
 
+	/* The number of leakage iterations made by the last solution */
+	size_t iterations;
+
+	/* The order of the model that is actually solved and the a-priori
+	 * bound of its temperature error per watt, see AnalyticalSolution.
+	 */
+	size_t state_count;
+	double error_bound;
+
 	public:
 
 	Hotspot(const std::string &floorplan_filename,
@@ -40,6 +52,26 @@ class Hotspot
 		const std::string &config_line);
 	virtual ~Hotspot();
 
+	inline size_t get_iterations() const
+	{
+		return iterations;
+	}
+
+	inline size_t get_node_count() const
+	{
+		return node_count;
+	}
+
+	inline size_t get_state_count() const
+	{
+		return state_count;
+	}
+
+	inline double get_error_bound() const
+	{
+		return error_bound;
+	}
+
 	/* Without leakage */
 	virtual void solve(const matrix_t &power, matrix_t &temperature)
 	{
@@ -68,6 +100,53 @@ class Hotspot
 		throw std::runtime_error("Solve by schedule is not implemented.");
 	}
 
+	/* Whether the constant solve below is available. Such a solution
+	 * does not change while solving and, thus, can be shared by several
+	 * threads, each with a workspace of its own.
+	 */
+	virtual bool reentrant() const
+	{
+		return false;
+	}
+
+	/* With and without leakage from a schedule, the number of
+	 * the leakage iterations is left in the workspace.
+	 */
+	virtual void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const
+	{
+		throw std::runtime_error("Reentrant solve is not implemented.");
+	}
+
+	/* With and without leakage from a batch of schedules */
+	virtual void solve_batch(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power)
+	{
+		size_t count = schedules.size();
+
+		temperature.resize(count);
+		power.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+			solve(*schedules[i], temperature[i], power[i]);
+	}
+
+	/* The constant counterpart of the above, the number of the leakage
+	 * iterations is left in the workspace.
+	 */
+	virtual void solve_batch(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+		SolverWorkspace &workspace) const
+	{
+		size_t count = schedules.size();
+
+		temperature.resize(count);
+		power.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+			solve(*schedules[i], temperature[i], power[i], workspace);
+	}
+
 	/* Verification */
 	virtual size_t verify(const matrix_t &power, matrix_t &temperature,
 		const matrix_t &reference)
@@ -104,10 +183,32 @@ class CondensedEquationHotspot: public Hotspot
 	CondensedEquationHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line);
+		const std::string &config_line, size_t thread_count = 1,
+		const reduction_t &reduction = reduction_t());
 
 	void solve(const matrix_t &power, matrix_t &temperature);
 	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+	void solve_batch(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power);
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
+	void solve_batch(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+		SolverWorkspace &workspace) const;
+
+	private:
+
+	/* Computes the power of the schedules and sizes the temperature */
+	void prepare(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+		std::vector<const double *> &_power,
+		std::vector<double *> &_temperature) const;
 };
 
 class LeakageCondensedEquationHotspot: public Hotspot
@@ -120,10 +221,102 @@ class LeakageCondensedEquationHotspot: public Hotspot
 	LeakageCondensedEquationHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line, const Leakage &leakage);
+		const std::string &config_line, const Leakage &leakage,
+		size_t history, const reduction_t &reduction = reduction_t());
+
+	void solve(const matrix_t &power, matrix_t &temperature, matrix_t &total_power);
+	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+	void solve_batch(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power);
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
+	void solve_batch(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &power,
+		SolverWorkspace &workspace) const;
+
+	private:
+
+	/* Computes the dynamic power of the schedules and sizes
+	 * the temperature and the total power.
+	 */
+	void prepare(const std::vector<const Schedule *> &schedules,
+		std::vector<matrix_t> &temperature, std::vector<matrix_t> &total_power,
+		std::vector<matrix_t> &power, std::vector<const double *> &_power,
+		std::vector<double *> &_temperature,
+		std::vector<double *> &_total_power) const;
+};
+
+class BandedCondensedEquationHotspot: public Hotspot
+{
+	BandedCondensedEquation equation;
+	const DynamicPower dynamic_power;
+
+	public:
+
+	BandedCondensedEquationHotspot(
+		const Architecture &architecture, const Graph &graph,
+		const std::string &floorplan, const std::string &config,
+		const std::string &config_line, const BandedLinearLeakage &leakage,
+		const reduction_t &reduction = reduction_t());
+
+	void solve(const matrix_t &power, matrix_t &temperature, matrix_t &total_power);
+	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+};
+
+class ModalCondensedEquationHotspot: public Hotspot
+{
+	ModalCondensedEquation equation;
+	const DynamicPower dynamic_power;
+
+	public:
+
+	ModalCondensedEquationHotspot(
+		const Architecture &architecture, const Graph &graph,
+		const std::string &floorplan, const std::string &config,
+		const std::string &config_line,
+		const reduction_t &reduction = reduction_t());
+
+	void solve(const matrix_t &power, matrix_t &temperature);
+	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
+};
+
+class LeakageModalCondensedEquationHotspot: public Hotspot
+{
+	LeakageModalCondensedEquation equation;
+	const DynamicPower dynamic_power;
+
+	public:
+
+	LeakageModalCondensedEquationHotspot(
+		const Architecture &architecture, const Graph &graph,
+		const std::string &floorplan, const std::string &config,
+		const std::string &config_line, const Leakage &leakage,
+		size_t history, const reduction_t &reduction = reduction_t());
 
 	void solve(const matrix_t &power, matrix_t &temperature, matrix_t &total_power);
 	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
 };
 
 class FixedCondensedEquationHotspot: public Hotspot
@@ -136,10 +329,19 @@ class FixedCondensedEquationHotspot: public Hotspot
 	FixedCondensedEquationHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line);
+		const std::string &config_line, size_t thread_count = 1,
+		const reduction_t &reduction = reduction_t());
 
 	void solve(const matrix_t &power, matrix_t &temperature);
 	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
 };
 
 class LeakageFixedCondensedEquationHotspot: public Hotspot
@@ -152,10 +354,19 @@ class LeakageFixedCondensedEquationHotspot: public Hotspot
 	LeakageFixedCondensedEquationHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line, const Leakage &leakage);
+		const std::string &config_line, const Leakage &leakage,
+		size_t history, const reduction_t &reduction = reduction_t());
 
 	void solve(const matrix_t &power, matrix_t &temperature, matrix_t &total_power);
 	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
 };
 
 class CoarseCondensedEquationHotspot: public Hotspot
@@ -187,7 +398,8 @@ class TransientAnalyticalHotspot: public Hotspot
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
 		const std::string &config_line, size_t max_iterations,
-		double tolerance, bool warmup);
+		double tolerance, bool warmup,
+		const reduction_t &reduction = reduction_t());
 
 	inline void solve(const matrix_t &power, matrix_t &temperature)
 	{
@@ -202,6 +414,19 @@ class TransientAnalyticalHotspot: public Hotspot
 		solve(power, temperature);
 	}
 
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	inline void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const
+	{
+		dynamic_power.compute(schedule, power);
+		temperature.resize(power);
+		equation.solve(power, temperature, power.rows(), workspace);
+	}
+
 	inline size_t verify(const matrix_t &power, matrix_t &temperature,
 		const matrix_t &reference)
 	{
@@ -217,73 +442,41 @@ class TransientAnalyticalHotspot: public Hotspot
 	}
 };
 
-typedef std::vector<int> SlotTrace;
-
-class Slot
+/* The grid model of HotSpot, which is too big for the eigenvalue
+ * decomposition, hence, it is kept in the sparse form and solved with
+ * the Krylov subspace methods.
+ */
+class KrylovGridHotspot: public Hotspot
 {
-	const size_t width;
-
-	Slot *blank;
-	std::vector<Slot *> children;
-
-	double *data;
+	KrylovCondensedEquation equation;
+	const DynamicPower dynamic_power;
 
 	public:
 
-	Slot(size_t _width) :
-		width(_width), blank(NULL), children(_width, NULL), data(NULL) {}
+	KrylovGridHotspot(
+		const Architecture &architecture, const Graph &graph,
+		const std::string &floorplan, const std::string &config,
+		const std::string &config_line, size_t krylov_dimension,
+		double tolerance);
 
-	~Slot()
+	inline void solve(const matrix_t &power, matrix_t &temperature)
 	{
-		__DELETE(blank);
-
-		size_t width = children.size();
-
-		for (size_t i = 0; i < width; i++)
-			__DELETE(children[i]);
-
-		__FREE(data);
+		temperature.resize(power);
+		equation.solve(power, temperature, power.rows());
 	}
 
-	inline Slot *find(const SlotTrace &trace)
+	inline void solve(const Schedule &schedule,
+		matrix_t &temperature, matrix_t &power)
 	{
-		Slot *current = this;
-		size_t i, size = trace.size();
-		int id;
-
-		for (i = 0; i < size; i++) {
-			id = trace[i];
-
-			if (id < 0) {
-				if (!current->blank)
-					current->blank = new Slot(width);
-
-				current = current->blank;
-			}
-			else {
-				if (!current->children[id])
-					current->children[id] = new Slot(width);
-
-				current = current->children[id];
-			}
-		}
-
-		return current;
+		dynamic_power.compute(schedule, power);
+		solve(power, temperature);
 	}
 
-	inline void store(double *data)
-	{
-#ifndef SHALLOW_CHECK
-		if (this->data)
-			throw std::runtime_error("The slot already has some data.");
-#endif
-		this->data = data;
-	}
+	protected:
 
-	inline double *get_data()
-	{
-		return data;
-	}
+	/* Recovers the sparse network from the slope function of the model */
+	static SparseNetwork extract(const RC_model_t *model,
+		size_t processor_count);
 };
 
 class BasicSteadyStateHotspot: public Hotspot
@@ -296,25 +489,45 @@ class BasicSteadyStateHotspot: public Hotspot
 
 	private:
 
-	Slot *storage;
 	size_t type_count;
 
 	std::vector<unsigned int> types;
 
+	mutable SlotCache cache;
+
+	SolverWorkspace workspace;
+
 	public:
 
+	/* NOTE: cache_size is in bytes */
 	BasicSteadyStateHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line);
-	~BasicSteadyStateHotspot();
+		const std::string &config_line, size_t cache_size);
 
-	void solve(const Schedule &schedule, matrix_t &temperature, matrix_t &power);
+	inline void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power)
+	{
+		solve(schedule, temperature, power, workspace);
+	}
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const;
+
+	inline const SlotCache &get_cache() const
+	{
+		return cache;
+	}
 
 	protected:
 
-	virtual double *compute(const SlotTrace &trace) = 0;
-	const double *get(const SlotTrace &trace);
+	virtual void compute(const SlotTrace &trace, double *temperature,
+		SolverWorkspace &workspace) const = 0;
 };
 
 class SteadyStateHotspot: public BasicSteadyStateHotspot
@@ -326,7 +539,8 @@ class SteadyStateHotspot: public BasicSteadyStateHotspot
 	SteadyStateHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line);
+		const std::string &config_line, size_t cache_size,
+		const reduction_t &reduction = reduction_t());
 
 	inline void solve(const matrix_t &power, matrix_t &temperature)
 	{
@@ -336,34 +550,36 @@ class SteadyStateHotspot: public BasicSteadyStateHotspot
 
 	protected:
 
-	double *compute(const SlotTrace &trace);
+	void compute(const SlotTrace &trace, double *temperature,
+		SolverWorkspace &workspace) const;
 };
 
 class LeakageSteadyStateHotspot: public BasicSteadyStateHotspot
 {
 	LeakageSteadyStateAnalyticalSolution equation;
 
-	vector_t dynamic_power;
-	vector_t total_power;
-
 	public:
 
 	LeakageSteadyStateHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line, const Leakage &leakage);
+		const std::string &config_line, const Leakage &leakage,
+		size_t history, size_t cache_size,
+		const reduction_t &reduction = reduction_t());
 
 	inline void solve(const matrix_t &power,
 		matrix_t &temperature, matrix_t &total_power)
 	{
 		temperature.resize(power);
 		total_power.resize(power);
-		equation.solve(power, temperature, total_power, power.rows());
+		iterations = equation.solve(power, temperature, total_power,
+			power.rows());
 	}
 
 	protected:
 
-	double *compute(const SlotTrace &trace);
+	void compute(const SlotTrace &trace, double *temperature,
+		SolverWorkspace &workspace) const;
 };
 
 class PreciseSteadyStateHotspot: public Hotspot
@@ -376,7 +592,8 @@ class PreciseSteadyStateHotspot: public Hotspot
 	PreciseSteadyStateHotspot(
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
-		const std::string &config_line, bool one_step = false);
+		const std::string &config_line, bool one_step = false,
+		const reduction_t &reduction = reduction_t());
 
 	inline void solve(const matrix_t &power, matrix_t &temperature)
 	{
@@ -391,6 +608,19 @@ class PreciseSteadyStateHotspot: public Hotspot
 		temperature.resize(power);
 		equation.solve(power, temperature, power.rows());
 	}
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	inline void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &power, SolverWorkspace &workspace) const
+	{
+		dynamic_power.compute(schedule, power);
+		temperature.resize(power);
+		equation.solve(power, temperature, power.rows(), workspace);
+	}
 };
 
 class LeakagePreciseSteadyStateHotspot: public Hotspot
@@ -404,14 +634,16 @@ class LeakagePreciseSteadyStateHotspot: public Hotspot
 		const Architecture &architecture, const Graph &graph,
 		const std::string &floorplan, const std::string &config,
 		const std::string &config_line, const Leakage &leakage,
-		bool one_step = false);
+		size_t history, bool one_step = false,
+		const reduction_t &reduction = reduction_t());
 
 	inline void solve(const matrix_t &power, matrix_t &temperature)
 	{
 		matrix_t total_power;
 		temperature.resize(power);
 		total_power.resize(power);
-		equation.solve(power, temperature, total_power, power.rows());
+		iterations = equation.solve(power, temperature, total_power,
+			power.rows());
 	}
 
 	inline void solve(const Schedule &schedule,
@@ -421,7 +653,8 @@ class LeakagePreciseSteadyStateHotspot: public Hotspot
 		dynamic_power.compute(schedule, power);
 		temperature.resize(power);
 		total_power.resize(power);
-		equation.solve(power, temperature, total_power, power.rows());
+		iterations = equation.solve(power, temperature, total_power,
+			power.rows());
 	}
 
 	inline void solve(const matrix_t &power,
@@ -429,7 +662,24 @@ class LeakagePreciseSteadyStateHotspot: public Hotspot
 	{
 		temperature.resize(power);
 		total_power.resize(power);
-		equation.solve(power, temperature, total_power, power.rows());
+		iterations = equation.solve(power, temperature, total_power,
+			power.rows());
+	}
+
+	bool reentrant() const
+	{
+		return true;
+	}
+
+	inline void solve(const Schedule &schedule, matrix_t &temperature,
+		matrix_t &total_power, SolverWorkspace &workspace) const
+	{
+		matrix_t power;
+		dynamic_power.compute(schedule, power);
+		temperature.resize(power);
+		total_power.resize(power);
+		workspace.iterations = equation.solve(power, temperature,
+			total_power, power.rows(), workspace);
 	}
 };
 
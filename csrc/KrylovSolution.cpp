@@ -0,0 +1,400 @@
+#include "KrylovSolution.h"
+
+static inline double dot(const double *A, const double *B, size_t n)
+{
+	double sum = 0;
+	for (size_t i = 0; i < n; i++) sum += A[i] * B[i];
+	return sum;
+}
+
+KrylovCondensedEquation::KrylovCondensedEquation(
+	size_t _processor_count, size_t _node_count,
+	double _sampling_interval, double _ambient_temperature,
+	const SparseNetwork &network, size_t _krylov_dimension,
+	double _tolerance) :
+
+	processor_count(_processor_count),
+	node_count(_node_count),
+	sampling_interval(_sampling_interval),
+	ambient_temperature(_ambient_temperature),
+	krylov_dimension(_krylov_dimension),
+	tolerance(_tolerance)
+{
+	size_t i, k;
+
+	if (krylov_dimension == 0)
+		throw std::runtime_error("The Krylov subspaces are empty.");
+
+	const sparse_matrix_t &G = network.conductance;
+	const sparse_matrix_t &M = network.distribution;
+	const sparse_matrix_t &N = network.observation;
+
+	vector_t sinvC(node_count);
+
+	for (i = 0; i < node_count; i++)
+		sinvC[i] = sqrt(1.0 / network.capacitance[i]);
+
+	/* S = C^(-1/2) * G * C^(-1/2), O = N * C^(-1/2) */
+	S = G;
+	invD.resize(node_count);
+
+	for (i = 0; i < node_count; i++)
+		for (k = S._offsets[i]; k < S._offsets[i + 1]; k++) {
+			S._values[k] *= sinvC[i] * sinvC[S._columns[k]];
+			if (S._columns[k] == i) invD[i] = 1.0 / S._values[k];
+		}
+
+	O = N;
+
+	for (k = 0; k < O.nonzeros(); k++)
+		O._values[k] *= sinvC[O._columns[k]];
+
+#ifdef MEASURE_TIME
+	struct timespec begin, end;
+	Time::measure(&begin);
+#endif
+
+	/* Z = S^(-1) * C^(-1/2) * M */
+	vector_t B(node_count);
+
+	ZT.resize(processor_count, node_count);
+
+	for (i = 0; i < processor_count; i++) {
+		B.nullify();
+
+		for (k = M._offsets[i]; k < M._offsets[i + 1]; k++)
+			B[M._columns[k]] = M._values[k] * sinvC[M._columns[k]];
+
+		solve_steady(B, ZT[i]);
+	}
+
+#ifdef MEASURE_TIME
+	Time::measure(&end);
+	decomposition_time = Time::substract(&end, &begin);
+#endif
+
+	V.resize(krylov_dimension + 1, node_count);
+	OV.resize(krylov_dimension, processor_count);
+
+	alpha.resize(krylov_dimension);
+	beta.resize(krylov_dimension);
+}
+
+void KrylovCondensedEquation::solve(const double *power,
+	double *temperature, size_t step_count)
+{
+	size_t i, j, k, u, v;
+
+	const size_t length = processor_count * processor_count;
+	const matrix_t &F = calculate_F(step_count);
+
+	for (i = 0; i < step_count * processor_count; i++)
+		temperature[i] = ambient_temperature;
+
+	/* The power is constant on [j, k), which gives
+	 * sum H(q) for q in [(i - k) mod m, (i - k) mod m + k - j).
+	 */
+	for (j = 0; j < step_count; j = k) {
+		const double *P = power + j * processor_count;
+
+		for (k = j + 1; k < step_count; k++)
+			if (memcmp(P, power + k * processor_count,
+				sizeof(double) * processor_count)) break;
+
+		for (i = 0; i < step_count; i++) {
+			const double *first = F[(i + step_count - k) % step_count];
+			const double *last = first + (k - j) * length;
+			double *row = temperature + i * processor_count;
+
+			for (v = 0; v < processor_count; v++)
+				for (u = 0; u < processor_count; u++)
+					row[v] += (last[v * processor_count + u] -
+						first[v * processor_count + u]) * P[u];
+		}
+	}
+}
+
+const matrix_t &KrylovCondensedEquation::calculate_F(size_t step_count)
+{
+	size_t i, u, v;
+
+	std::list<kernel_t>::iterator it;
+
+	for (it = kernels.begin(); it != kernels.end(); it++)
+		if (it->first == step_count) {
+			/* Move to the front as the most recently used */
+			if (it != kernels.begin())
+				kernels.splice(kernels.begin(), kernels, it);
+			return kernels.front().second;
+		}
+
+	if (kernels.size() >= MAX_CACHED_KERNELS) {
+		/* Reuse the least recently used one */
+		kernels.splice(kernels.begin(), kernels, --kernels.end());
+	}
+	else kernels.push_front(kernel_t(0, matrix_t()));
+
+	kernel_t &entry = kernels.front();
+	entry.first = step_count;
+
+	matrix_t &F = entry.second;
+	F.resize(2 * step_count + 1, processor_count * processor_count);
+
+	vector_t X(node_count), R(node_count);
+	matrix_t H(step_count, processor_count);
+
+	for (i = 0; i < processor_count * processor_count; i++) F[0][i] = 0;
+
+	for (u = 0; u < processor_count; u++) {
+		/* G * e(u) = S^(-1) * (I - K) * C^(-1/2) * M * e(u) = Z - K * Z */
+		__MEMCPY(X, ZT[u], node_count);
+		advance(X, 1);
+		for (i = 0; i < node_count; i++) R[i] = ZT[u][i] - X[i];
+
+		/* (I - K^m)^(-1) * G * e(u) */
+		solve_periodic(R, X, step_count);
+
+		/* O * K^q * (I - K^m)^(-1) * G * e(u) */
+		H.nullify();
+		advance(X, step_count, H);
+
+		for (i = 0; i < 2 * step_count; i++)
+			for (v = 0; v < processor_count; v++)
+				F[i + 1][v * processor_count + u] =
+					F[i][v * processor_count + u] + H[i % step_count][v];
+	}
+
+	return F;
+}
+
+void KrylovCondensedEquation::advance(double *X, size_t step_count,
+	double *temperature)
+{
+	size_t i, j, k, next = 0;
+	size_t dimension;
+	bool invariant;
+
+	const double total = step_count * sampling_interval;
+	double now = 0, tau = total;
+
+	vector_t E(krylov_dimension), U(krylov_dimension);
+
+	while (true) {
+		double norm = sqrt(dot(X, X, node_count));
+		if (norm == 0) return;
+
+		dimension = lanczos(X, norm, invariant);
+
+		/* exp(-S * t) * X = norm * V * Q * exp(-L * t) * QT * e1,
+		 * where the error is estimated with the residual of the last
+		 * vector, and the step is halved until it is small enough.
+		 */
+		while (true) {
+			tau = std::min(tau, total - now);
+
+			for (i = 0; i < dimension; i++)
+				E[i] = exp(-tau * L[i]) * Q[0][i];
+			for (i = 0; i < dimension; i++)
+				U[i] = dot(Q[i], E, dimension);
+
+			if (invariant) break;
+
+			double error = beta[dimension - 1] * fabs(U[dimension - 1]);
+			if (error <= tolerance) break;
+
+			tau /= 2;
+		}
+
+		if (temperature) {
+			for (i = 0; i < dimension; i++)
+				multiply_sparse_matrix_vector(O, V[i], OV[i]);
+
+			for (; next < step_count &&
+				next * sampling_interval <= now + tau; next++) {
+
+				double t = next * sampling_interval - now;
+				double *row = temperature + next * processor_count;
+
+				for (i = 0; i < dimension; i++)
+					E[i] = exp(-t * L[i]) * Q[0][i];
+
+				for (i = 0; i < dimension; i++) {
+					double weight = norm * dot(Q[i], E, dimension);
+					for (j = 0; j < processor_count; j++)
+						row[j] += weight * OV[i][j];
+				}
+			}
+		}
+
+		for (k = 0; k < node_count; k++) X[k] = 0;
+		for (i = 0; i < dimension; i++)
+			for (k = 0; k < node_count; k++)
+				X[k] += norm * U[i] * V[i][k];
+
+		now += tau;
+		if (total - now <= DBL_EPSILON * total) break;
+
+		tau *= 2;
+	}
+}
+
+size_t KrylovCondensedEquation::lanczos(const double *X,
+	double norm, bool &invariant)
+{
+	size_t i, j, k;
+
+	for (k = 0; k < node_count; k++) V[0][k] = X[k] / norm;
+
+	invariant = false;
+
+	for (j = 0; j < krylov_dimension;) {
+		double *W = V[j + 1];
+
+		multiply_sparse_matrix_vector(S, V[j], W);
+
+		if (j > 0)
+			for (k = 0; k < node_count; k++)
+				W[k] -= beta[j - 1] * V[j - 1][k];
+
+		alpha[j] = dot(W, V[j], node_count);
+
+		for (k = 0; k < node_count; k++)
+			W[k] -= alpha[j] * V[j][k];
+
+		beta[j] = sqrt(dot(W, W, node_count));
+
+		j++;
+
+		if (beta[j - 1] <= DBL_EPSILON * fabs(alpha[j - 1])) {
+			invariant = true;
+			break;
+		}
+
+		for (k = 0; k < node_count; k++)
+			W[k] /= beta[j - 1];
+	}
+
+	/* T = V^T * S * V = Q * L * QT */
+	T.resize(j, j);
+	T.nullify();
+
+	for (i = 0; i < j; i++) {
+		T[i][i] = alpha[i];
+		if (i + 1 < j) T[i][i + 1] = T[i + 1][i] = beta[i];
+	}
+
+	L.resize(j);
+	EigenvalueDecomposition decomposition(T, Q, L);
+
+	return j;
+}
+
+void KrylovCondensedEquation::solve_steady(const double *R, double *X,
+	double shift) const
+{
+	size_t i, k;
+
+	vector_t Rk(node_count), Zk(node_count), P(node_count), SP(node_count);
+	vector_t invDs(node_count);
+
+	for (i = 0; i < node_count; i++) {
+		invDs[i] = 1.0 / (1.0 / invD[i] + shift);
+
+		X[i] = 0;
+		Rk[i] = R[i];
+		P[i] = Zk[i] = invDs[i] * Rk[i];
+	}
+
+	double bound = tolerance * tolerance * dot(R, R, node_count);
+	double rz = dot(Rk, Zk, node_count);
+
+	if (bound == 0) return;
+
+	for (k = 0; k < node_count; k++) {
+		multiply_sparse_matrix_vector(S, P, SP);
+		for (i = 0; i < node_count; i++) SP[i] += shift * P[i];
+
+		double a = rz / dot(P, SP, node_count);
+
+		for (i = 0; i < node_count; i++) {
+			X[i] += a * P[i];
+			Rk[i] -= a * SP[i];
+		}
+
+		if (dot(Rk, Rk, node_count) <= bound) return;
+
+		for (i = 0; i < node_count; i++) Zk[i] = invDs[i] * Rk[i];
+
+		double next = dot(Rk, Zk, node_count);
+
+		for (i = 0; i < node_count; i++)
+			P[i] = Zk[i] + next / rz * P[i];
+
+		rz = next;
+	}
+
+	throw std::runtime_error("The conjugate gradients do not converge.");
+}
+
+void KrylovCondensedEquation::precondition(const double *R, double *Z,
+	size_t step_count) const
+{
+	const double tau = step_count * sampling_interval;
+
+	vector_t X(node_count);
+
+	solve_steady(R, Z);
+	solve_steady(R, X, 4 / tau);
+
+	for (size_t i = 0; i < node_count; i++)
+		Z[i] = Z[i] / tau + R[i] - 2 / tau * X[i];
+}
+
+void KrylovCondensedEquation::solve_periodic(const double *R, double *X,
+	size_t step_count)
+{
+	size_t i, k;
+
+	vector_t Rk(node_count), Zk(node_count), P(node_count), AP(node_count);
+
+	for (i = 0; i < node_count; i++) {
+		X[i] = 0;
+		Rk[i] = R[i];
+	}
+
+	double bound = tolerance * tolerance * dot(R, R, node_count);
+
+	if (bound == 0) return;
+
+	precondition(Rk, Zk, step_count);
+	__MEMCPY(P, Zk, node_count);
+
+	double rz = dot(Rk, Zk, node_count);
+
+	for (k = 0; k < node_count; k++) {
+		/* AP = (I - exp(-S * tau)) * P */
+		__MEMCPY(AP, P, node_count);
+		advance(AP, step_count);
+		for (i = 0; i < node_count; i++) AP[i] = P[i] - AP[i];
+
+		double a = rz / dot(P, AP, node_count);
+
+		for (i = 0; i < node_count; i++) {
+			X[i] += a * P[i];
+			Rk[i] -= a * AP[i];
+		}
+
+		if (dot(Rk, Rk, node_count) <= bound) return;
+
+		precondition(Rk, Zk, step_count);
+
+		double next = dot(Rk, Zk, node_count);
+
+		for (i = 0; i < node_count; i++)
+			P[i] = Zk[i] + next / rz * P[i];
+
+		rz = next;
+	}
+
+	throw std::runtime_error("The conjugate gradients do not converge.");
+}
@@ -0,0 +1,153 @@
+#ifndef __KRYLOV_SOLUTION_H__
+#define __KRYLOV_SOLUTION_H__
+
+#include "common.h"
+
+#define MAX_CACHED_KERNELS 8
+
+#ifdef MEASURE_TIME
+#include "Helper.h"
+#endif
+
+/* A thermal RC network kept in the sparse form */
+struct SparseNetwork
+{
+	/* Conductance, G (node_count x node_count, symmetric) */
+	sparse_matrix_t conductance;
+
+	/* Capacitance, the diagonal of C (node_count) */
+	vector_t capacitance;
+
+	/* Processor power to the node power (processor_count x node_count) */
+	sparse_matrix_t distribution;
+
+	/* Node temperature to the processor temperature
+	 * (processor_count x node_count)
+	 */
+	sparse_matrix_t observation;
+};
+
+/* The periodic solution of the condensed equation for networks that are
+ * too big for the eigenvalue decomposition. With the same substitution
+ * as in AnalyticalSolution, Y = C^(1/2) * (T - T_amb), we have:
+ *
+ * dY/dt = -S * Y + C^(-1/2) * M * B
+ *
+ * where S = C^(-1/2) * G * C^(-1/2) is symmetric positive definite and
+ * sparse. Nothing of node_count x node_count is ever formed: exp(-S * t)
+ * is applied to vectors in Krylov subspaces built with the Lanczos
+ * process, and S is inverted with the preconditioned conjugate gradients.
+ *
+ * With K = exp(-S * dt), Y(i+1) = K * Y(i) + G * B(i), and Y(0) = Y(m),
+ * the periodic temperature is a circular convolution of the power:
+ *
+ * T(i) = T_amb + sum H((i - 1 - j) mod m) * B(j)
+ * H(q) = O * K^q * (I - K^m)^(-1) * G
+ *
+ * where H(q) is processor_count x processor_count. The columns of H
+ * are the responses to each processor alone, which are found by one
+ * iterative periodic solve and one Krylov pass over the period each.
+ */
+class KrylovCondensedEquation
+{
+#ifdef MEASURE_TIME
+	public:
+
+	double decomposition_time;
+#endif
+
+	const size_t processor_count;
+	const size_t node_count;
+
+	const double sampling_interval;
+	const double ambient_temperature;
+
+	/* The maximal dimension of the Krylov subspaces */
+	const size_t krylov_dimension;
+
+	/* The relative tolerance of the exponentials and of the solves */
+	const double tolerance;
+
+	/* S = C^(-1/2) * G * C^(-1/2) */
+	sparse_matrix_t S;
+
+	/* The Jacobi preconditioner, the inverse of the diagonal of S */
+	vector_t invD;
+
+	/* Y to the processor temperature (processor_count x node_count):
+	 * O = N * C^(-1/2)
+	 */
+	sparse_matrix_t O;
+
+	/* The steady state in Y for each processor dissipating a unit of
+	 * power (processor_count x node_count, the states go along the rows):
+	 * ZT = (S^(-1) * C^(-1/2) * M)^T
+	 */
+	matrix_t ZT;
+
+	/* The prefix sums of the kernel over two periods,
+	 * F(q) = sum H(r mod m) for r in [0, q), (2 * m + 1) x (processor_count^2),
+	 * so that the sum over a segment of constant power is a difference.
+	 * They depend on the number of steps only and are kept for
+	 * the recently used ones.
+	 */
+	typedef std::pair<size_t, matrix_t> kernel_t;
+	std::list<kernel_t> kernels;
+
+	/* The Lanczos basis along the rows, (krylov_dimension + 1) x node_count,
+	 * and its processor temperature, krylov_dimension x processor_count.
+	 */
+	matrix_t V;
+	matrix_t OV;
+
+	/* The tridiagonal projection of S and its decomposition */
+	vector_t alpha;
+	vector_t beta;
+	matrix_t T;
+	matrix_t Q;
+	vector_t L;
+
+	public:
+
+	KrylovCondensedEquation(size_t _processor_count, size_t _node_count,
+		double _sampling_interval, double _ambient_temperature,
+		const SparseNetwork &network, size_t _krylov_dimension,
+		double _tolerance);
+
+	/* NOTE: power should be of size (step_count x processor_count) */
+	void solve(const double *power, double *temperature, size_t step_count);
+
+	private:
+
+	const matrix_t &calculate_F(size_t step_count);
+
+	/* X = exp(-S * step_count * dt) * X. The basis is kept while it is
+	 * accurate enough, and, if temperature is given, O * exp(-S * i * dt) * X
+	 * is added to its i-th row for every i in [0, step_count).
+	 */
+	void advance(double *X, size_t step_count, double *temperature = NULL);
+
+	/* Builds the Lanczos basis for X and decomposes the projection,
+	 * returns the dimension of the basis, which is smaller than
+	 * krylov_dimension when the subspace turns out to be invariant.
+	 */
+	size_t lanczos(const double *X, double norm, bool &invariant);
+
+	/* Solves (S + shift * I) * X = R */
+	void solve_steady(const double *R, double *X, double shift = 0) const;
+
+	/* Z = ((S * tau)^(-1) + (2 * I + S * tau) * (4 * I + S * tau)^(-1)) * R
+	 * for tau = step_count * dt, which approximates (I - exp(-S * tau))^(-1):
+	 * the expansion at zero is the same up to the constant term, and it goes
+	 * to I at infinity. Since the functions of S commute, the preconditioned
+	 * operator stays symmetric, and its spectrum is within [0.95, 1.02].
+	 */
+	void precondition(const double *R, double *Z, size_t step_count) const;
+
+	/* Solves (I - exp(-S * tau)) * X = R with the preconditioned
+	 * conjugate gradients, so a few iterations are enough.
+	 */
+	void solve_periodic(const double *R, double *X, size_t step_count);
+};
+
+#endif
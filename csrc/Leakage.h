@@ -15,6 +15,10 @@ class Leakage
 	{
 	}
 
+	virtual ~Leakage()
+	{
+	}
+
 	virtual inline size_t get_max_iterations() const
 	{
 		return max_iterations;
@@ -74,22 +78,53 @@ class ExponentialLeakage: public Leakage
 	 */
 	static const double Is = 995.7996;
 
+	/* The range of temperatures covered by the table, the closed form
+	 * is used outside of it.
+	 */
+	static const double table_min = 273.15;
+	static const double table_max = 273.15 + 200;
+	static const double min_table_step = 1e-3;
+
 	const size_t processor_count;
 	std::vector<double> voltages;
 	std::vector<unsigned long int> ngates;
 
+	/* alpha * Vdd + beta and B * e^(gamma * Vdd + delta) */
+	std::vector<double> exponents;
+	std::vector<double> constants;
+
+	/* The leakage of each processor sampled over [table_min, table_max]
+	 * with table_step, linearly interpolated in between. Empty when
+	 * the closed form is used everywhere.
+	 */
+	size_t table_size;
+	double table_step;
+	std::vector<double> table;
+
 	public:
 
-	ExponentialLeakage(const processor_vector_t &processors) :
-		processor_count(processors.size())
+	/* NOTE: with the precision of zero, the leakage is computed
+	 * in the closed form, otherwise, the table is made dense enough
+	 * for the relative error not to exceed the precision.
+	 */
+	ExponentialLeakage(const processor_vector_t &processors,
+		double precision = 0) :
+		processor_count(processors.size()),
+		table_size(0), table_step(0)
 	{
 		voltages.resize(processor_count);
 		ngates.resize(processor_count);
+		exponents.resize(processor_count);
+		constants.resize(processor_count);
 
 		for (size_t i = 0; i < processor_count; i++) {
 			voltages[i] = processors[i]->get_voltage();
 			ngates[i] = processors[i]->get_ngate();
+			exponents[i] = alpha * voltages[i] + beta;
+			constants[i] = B * exp(gamma * voltages[i] + delta);
 		}
+
+		if (precision > 0) tabulate(precision);
 	}
 
 	static double calculate(const Processor *processor, double temperature)
@@ -121,20 +156,14 @@ class ExponentialLeakage: public Leakage
 		size_t step_count = 1) const
 	{
 		size_t i, j, k;
-		double favg, voltage;
-		unsigned long int ngate;
+		double leakage;
 
-		for (i = 0, k = 0; i < step_count; i++) {
-			for (j = 0; j < processor_count; j++, k++) {
-				voltage = voltages[j];
-				ngate = ngates[j];
+		/* The same for all the steps */
+		for (j = 0; j < processor_count; j++) {
+			leakage = evaluate(j, temperature);
 
-				favg = A * temperature * temperature *
-					exp((alpha * voltage + beta) / temperature) +
-					B * exp(gamma * voltage + delta);
-
-				total_power[k] = dynamic_power[k] + ngate * Is * favg * voltage;
-			}
+			for (i = 0, k = j; i < step_count; i++, k += processor_count)
+				total_power[k] = dynamic_power[k] + leakage;
 		}
 	}
 
@@ -142,22 +171,98 @@ class ExponentialLeakage: public Leakage
 		const double *dynamic_power, double *total_power,
 		size_t step_count = 1) const
 	{
-		size_t i, j, k;
-		double favg, voltage;
-		unsigned long int ngate;
+		size_t i, j, k, n;
+		double x;
 
-		for (i = 0, k = 0; i < step_count; i++) {
-			for (j = 0; j < processor_count; j++, k++) {
-				voltage = voltages[j];
-				ngate = ngates[j];
+		if (table.empty()) {
+			for (i = 0, k = 0; i < step_count; i++)
+				for (j = 0; j < processor_count; j++, k++)
+					total_power[k] = dynamic_power[k] +
+						evaluate(j, temperature[k]);
+
+			return;
+		}
+
+		const double scale = 1.0 / table_step;
+		const double limit = double(table_size - 1);
+
+		/* Processor by processor, the interpolation goes without
+		 * branches, so that it can be vectorized.
+		 */
+		for (j = 0; j < processor_count; j++) {
+			const double *_table = &table[j * table_size];
+
+			for (i = 0, k = j; i < step_count; i++, k += processor_count) {
+				x = (temperature[k] - table_min) * scale;
+				x = x < 0 ? 0 : x;
+				x = x < limit ? x : limit;
 
-				favg = A * temperature[k] * temperature[k] *
-					exp((alpha * voltage + beta) / temperature[k]) +
-					B * exp(gamma * voltage + delta);
+				n = (size_t)x;
+				n = n < table_size - 2 ? n : table_size - 2;
+				x -= double(n);
 
-				total_power[k] = dynamic_power[k] + ngate * Is * favg * voltage;
+				total_power[k] = dynamic_power[k] + _table[n] +
+					x * (_table[n + 1] - _table[n]);
 			}
 		}
+
+		/* The rest is in the closed form, NOTE: NaN goes here as well */
+		for (i = 0, k = 0; i < step_count; i++)
+			for (j = 0; j < processor_count; j++, k++) {
+				x = (temperature[k] - table_min) * scale;
+				if (!(x >= 0 && x < limit))
+					total_power[k] = dynamic_power[k] +
+						evaluate(j, temperature[k]);
+			}
+	}
+
+	private:
+
+	inline double evaluate(size_t i, double temperature) const
+	{
+		const double favg = A * temperature * temperature *
+			exp(exponents[i] / temperature) + constants[i];
+
+		return ngates[i] * Is * favg * voltages[i];
+	}
+
+	/* The interpolation error is the largest between the nodes,
+	 * hence, the step is halved until it is fine there.
+	 */
+	void tabulate(double precision)
+	{
+		size_t i, j;
+		double T, error, max_error;
+
+		for (table_step = 1;; table_step /= 2) {
+			if (table_step < min_table_step)
+				throw std::runtime_error("The leakage precision is too high.");
+
+			table_size = size_t((table_max - table_min) / table_step) + 1;
+
+			max_error = 0;
+			for (i = 0; i < processor_count; i++)
+				for (j = 0; j + 1 < table_size; j++) {
+					T = table_min + (double(j) + 0.5) * table_step;
+
+					const double exact = evaluate(i, T);
+					const double approximate = (
+						evaluate(i, table_min + double(j) * table_step) +
+						evaluate(i, table_min + double(j + 1) * table_step)) / 2;
+
+					error = std::abs(approximate - exact) / exact;
+					if (max_error < error) max_error = error;
+				}
+
+			if (max_error <= precision) break;
+		}
+
+		table.resize(processor_count * table_size);
+
+		for (i = 0; i < processor_count; i++)
+			for (j = 0; j < table_size; j++)
+				table[i * table_size + j] =
+					evaluate(i, table_min + double(j) * table_step);
 	}
 };
 
@@ -312,4 +417,154 @@ class PiecewiseLinearLeakage: public BasicLinearLeakage
 	}
 };
 
+/* Linear fits over several temperature bands, each processor takes
+ * the fit of the band its temperature falls into. Used as is,
+ * it is iterated like any other nonlinear leakage; the banded solvers,
+ * instead, fold the slopes of the chosen bands into the conductance.
+ */
+class BandedLinearLeakage: public Leakage
+{
+	static const double T1 = 30 + 273.15;
+	static const double T2 = 130 + 273.15;
+	static const size_t N = 20;
+
+	const size_t processor_count;
+	const size_t band_count;
+
+	/* processor_count x band_count */
+	std::vector<double> k;
+	std::vector<double> b;
+
+	public:
+
+	BandedLinearLeakage(const processor_vector_t &processors,
+		size_t _band_count) :
+		processor_count(processors.size()),
+		band_count(_band_count)
+	{
+		if (band_count == 0)
+			throw std::runtime_error("The number of bands is invalid.");
+
+		k.resize(processor_count * band_count);
+		b.resize(processor_count * band_count);
+
+		double sxy, sx, sy, ssx, T, P, low, high;
+
+		const double width = (T2 - T1) / double(band_count);
+
+		/* Least square fit in each band, the fit goes over the band and
+		 * its neighbors since the temperature of a processor swings
+		 * around the one the band is chosen for.
+		 */
+		for (size_t i = 0; i < processor_count; i++)
+			for (size_t l = 0; l < band_count; l++) {
+				low = T1 + double(l) * width - width;
+				high = T1 + double(l + 1) * width + width;
+
+				sxy = sx = sy = ssx = 0;
+
+				for (size_t j = 0; j <= N; j++) {
+					T = low + double(j) * (high - low) / double(N);
+					P = ExponentialLeakage::calculate(processors[i], T);
+
+					sxy += T * P;
+					sx += T;
+					sy += P;
+					ssx += T * T;
+				}
+
+				const size_t m = i * band_count + l;
+				const double n = double(N + 1);
+
+				k[m] = (n * sxy - sx * sy) / (n * ssx - sx * sx);
+				b[m] = (sy - k[m] * sx) / n;
+			}
+	}
+
+	inline size_t get_band_count() const
+	{
+		return band_count;
+	}
+
+	/* The bands below T1 and above T2 are extrapolated */
+	inline size_t select(double temperature) const
+	{
+		const double x = (temperature - T1) / (T2 - T1) * double(band_count);
+
+		/* NOTE: also zero for NaN */
+		if (!(x > 0)) return 0;
+		if (x >= double(band_count - 1)) return band_count - 1;
+
+		return size_t(x);
+	}
+
+	/* Moves the temperature-dependent part of the leakage in the given
+	 * bands to the conductance, see LinearLeakage::setup.
+	 */
+	inline void fold(double **conductance, const size_t *bands) const
+	{
+		for (size_t i = 0; i < processor_count; i++)
+			conductance[i][i] -= k[i * band_count + bands[i]];
+	}
+
+	/* What is left after the folding */
+	void inject(const size_t *bands, double ambient_temperature,
+		const double *dynamic_power, double *total_power,
+		size_t step_count) const
+	{
+		size_t i, j, l, m;
+
+		for (i = 0, l = 0; i < step_count; i++)
+			for (j = 0; j < processor_count; j++, l++) {
+				m = j * band_count + bands[j];
+				total_power[l] = dynamic_power[l] +
+					b[m] + k[m] * ambient_temperature;
+			}
+	}
+
+	void finalize(const size_t *bands, const double *temperature,
+		const double *dynamic_power, double *total_power,
+		size_t step_count) const
+	{
+		size_t i, j, l, m;
+
+		for (i = 0, l = 0; i < step_count; i++)
+			for (j = 0; j < processor_count; j++, l++) {
+				m = j * band_count + bands[j];
+				total_power[l] = dynamic_power[l] +
+					k[m] * temperature[l] + b[m];
+			}
+	}
+
+	void inject(double temperature,
+		const double *dynamic_power, double *total_power,
+		size_t step_count = 1) const
+	{
+		size_t i, j, l, m;
+
+		const size_t band = select(temperature);
+
+		for (i = 0, l = 0; i < step_count; i++)
+			for (j = 0; j < processor_count; j++, l++) {
+				m = j * band_count + band;
+				total_power[l] = dynamic_power[l] +
+					k[m] * temperature + b[m];
+			}
+	}
+
+	void inject(const double *temperature,
+		const double *dynamic_power, double *total_power,
+		size_t step_count = 1) const
+	{
+		size_t i, j, l, m;
+
+		for (i = 0, l = 0; i < step_count; i++)
+			for (j = 0; j < processor_count; j++, l++) {
+				m = j * band_count + select(temperature[l]);
+				total_power[l] = dynamic_power[l] +
+					k[m] * temperature[l] + b[m];
+			}
+	}
+};
+
 #endif
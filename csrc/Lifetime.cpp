@@ -2,9 +2,13 @@
 #include "Architecture.h"
 #include "Graph.h"
 
-double ThermalCyclingLifetime::predict(
-	const matrix_t &temperature, double sampling_interval)
+double ThermalCyclingLifetime::predict(const matrix_t &temperature,
+	double sampling_interval, LifetimeWorkspace &workspace) const
 {
+	const double *amplitudes = workspace.amplitudes;
+	const double *means = workspace.means;
+	const double *cycles = workspace.cycles;
+
 	const double Q = q; /* Some stupid joke */
 
 	size_t processor_count = temperature.cols();
@@ -16,8 +20,9 @@ double ThermalCyclingLifetime::predict(
 
 	/* For each temperature curve */
 	for (size_t i = 0; i < processor_count; i++) {
-		size_t peak_count = update_peaks(data, step_count, processor_count, i);
-		size_t cycle_count = update_cycles(peak_count);
+		size_t peak_count = update_peaks(data, step_count, processor_count, i,
+			workspace);
+		size_t cycle_count = update_cycles(peak_count, workspace);
 
 		double damage = 0;
 
@@ -47,8 +52,11 @@ double ThermalCyclingLifetime::predict(
 #define LF_MAX 2
 
 size_t ThermalCyclingLifetime::update_peaks(const double *data,
-	size_t rows, size_t cols, size_t col)
+	size_t rows, size_t cols, size_t col, LifetimeWorkspace &workspace) const
 {
+	double *&peak_index = workspace.peak_index;
+	double *peaks = workspace.peaks;
+
 	size_t count, mxpos, mnpos, row, first_pos = 0, last_pos = 0;
 	double current, mx, mn;
 
@@ -186,11 +194,17 @@ size_t ThermalCyclingLifetime::update_peaks(const double *data,
 	return count;
 }
 
-size_t ThermalCyclingLifetime::update_cycles(size_t extremum_count)
+size_t ThermalCyclingLifetime::update_cycles(size_t extremum_count,
+	LifetimeWorkspace &workspace) const
 {
 	int i, j;
 	size_t count = 0;
-	double amplitude, mean, *a = temp;
+	double amplitude, mean, *a = workspace.temp;
+
+	double *&peak_index = workspace.peak_index;
+	double *amplitudes = workspace.amplitudes;
+	double *means = workspace.means;
+	double *cycles = workspace.cycles;
 
 	for (i = 0, j = -1; i < extremum_count; i++, peak_index++) {
 		a[++j] = *peak_index;
@@ -246,9 +260,13 @@ size_t ThermalCyclingLifetime::update_cycles(size_t extremum_count)
 	return count;
 }
 
-double CombinedThermalCyclingLifetime::predict(
-	const matrix_t &temperature, double sampling_interval)
+double CombinedThermalCyclingLifetime::predict(const matrix_t &temperature,
+	double sampling_interval, LifetimeWorkspace &workspace) const
 {
+	const double *amplitudes = workspace.amplitudes;
+	const double *means = workspace.means;
+	const double *cycles = workspace.cycles;
+
 	const double Q = q; /* Some stupid joke */
 
 	size_t processor_count = temperature.cols();
@@ -260,8 +278,9 @@ double CombinedThermalCyclingLifetime::predict(
 
 	/* For each temperature curve */
 	for (size_t i = 0; i < processor_count; i++) {
-		size_t peak_count = update_peaks(data, step_count, processor_count, i);
-		size_t cycle_count = update_cycles(peak_count);
+		size_t peak_count = update_peaks(data, step_count, processor_count, i,
+			workspace);
+		size_t cycle_count = update_cycles(peak_count, workspace);
 
 		damage = 0;
 
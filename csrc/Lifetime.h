@@ -6,16 +6,35 @@
 typedef std::pair<unsigned int, double> peak_t;
 typedef std::list<peak_t > extrema_t;
 
+#define MAX_EXTREMA 1000
+
+/* Everything that the prediction changes, one per thread */
+struct LifetimeWorkspace
+{
+	double *peak_index;
+	double peaks[MAX_EXTREMA + 1];
+
+	double temp[MAX_EXTREMA];
+	double amplitudes[MAX_EXTREMA];
+	double means[MAX_EXTREMA];
+	double cycles[MAX_EXTREMA];
+};
+
 class Lifetime
 {
 	public:
 
+	inline double predict(const matrix_t &temperature,
+		double sampling_interval) const
+	{
+		LifetimeWorkspace workspace;
+		return predict(temperature, sampling_interval, workspace);
+	}
+
 	virtual double predict(const matrix_t &temperature,
-		double sampling_interval) = 0;
+		double sampling_interval, LifetimeWorkspace &workspace) const = 0;
 };
 
-#define MAX_EXTREMA 1000
-
 class ThermalCyclingLifetime: public Lifetime
 {
 	protected:
@@ -51,27 +70,27 @@ class ThermalCyclingLifetime: public Lifetime
 
 	public:
 
-	virtual double predict(const matrix_t &temperature, double sampling_interval);
-
-	protected:
+	using Lifetime::predict;
 
-	double *peak_index;
-	double peaks[MAX_EXTREMA + 1];
+	virtual double predict(const matrix_t &temperature,
+		double sampling_interval, LifetimeWorkspace &workspace) const;
 
-	double temp[MAX_EXTREMA];
-	double amplitudes[MAX_EXTREMA];
-	double means[MAX_EXTREMA];
-	double cycles[MAX_EXTREMA];
+	protected:
 
-	size_t update_peaks(const double *data, size_t rows, size_t cols, size_t col);
-	size_t update_cycles(size_t extremum_count);
+	size_t update_peaks(const double *data, size_t rows, size_t cols,
+		size_t col, LifetimeWorkspace &workspace) const;
+	size_t update_cycles(size_t extremum_count,
+		LifetimeWorkspace &workspace) const;
 };
 
 class CombinedThermalCyclingLifetime: public ThermalCyclingLifetime
 {
 	public:
 
-	virtual double predict(const matrix_t &temperature, double sampling_interval);
+	using Lifetime::predict;
+
+	virtual double predict(const matrix_t &temperature,
+		double sampling_interval, LifetimeWorkspace &workspace) const;
 };
 
 /* % References:
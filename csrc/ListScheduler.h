@@ -1,20 +1,85 @@
 #ifndef __LIST_SCHEDULER_H__
 #define __LIST_SCHEDULER_H__
 
+#include <typeinfo>
+
 #include "common.h"
 #include "Architecture.h"
 #include "Processor.h"
 #include "Graph.h"
 #include "Task.h"
 #include "Schedule.h"
+#include "ScheduleTrail.h"
 #include "Pool.h"
 
+/* What a scheduler keeps between the calls, one per thread. The pool is
+ * made by the first scheduler to use the workspace and is only reset
+ * afterwards, another scheduler makes its own.
+ */
+class SchedulerWorkspace
+{
+	template<class PT>
+	friend class ListScheduler;
+
+	const void *owner;
+	Pool *pool;
+
+	/* The number of parents yet to be scheduled */
+	std::vector<size_t> remaining;
+
+	/* The tasks with some of their parents scheduled, but not yet
+	 * themselves, and where they are in the list, kept for the trails.
+	 */
+	std::vector<tid_t> touched;
+	std::vector<size_t> position;
+
+	public:
+
+	SchedulerWorkspace() : owner(NULL), pool(NULL) {}
+
+	/* NOTE: the copies start empty */
+	SchedulerWorkspace(const SchedulerWorkspace &another) :
+		owner(NULL), pool(NULL) {}
+
+	~SchedulerWorkspace()
+	{
+		__DELETE(pool);
+	}
+
+	inline SchedulerWorkspace &operator=(const SchedulerWorkspace &another)
+	{
+		return *this;
+	}
+};
+
 class BasicListScheduler
 {
 	public:
 
+	virtual ~BasicListScheduler() {}
+
 	virtual Schedule process(const layout_t &layout, const priority_t &priority,
 		void *data = NULL) const = 0;
+
+	/* The same as above, but the schedule is written over the given one,
+	 * and nothing is allocated once the workspace and the schedule
+	 * have been used for the same problem.
+	 */
+	virtual void process_into(const layout_t &layout, const priority_t &priority,
+		Schedule &schedule, SchedulerWorkspace &workspace,
+		void *data = NULL) const = 0;
+
+	/* The same as above, but starts from the last checkpoint of
+	 * the previous trail that the differences in the layout and priority
+	 * leave intact, and records the new trail. Either of the trails can
+	 * be NULL, and both are ignored by the pools that cannot be resumed.
+	 * The two can also be the same, then the trail is written over in
+	 * place from the checkpoint on.
+	 */
+	virtual void process_into(const layout_t &layout, const priority_t &priority,
+		Schedule &schedule, SchedulerWorkspace &workspace,
+		const ScheduleTrail *previous, ScheduleTrail *trail,
+		void *data = NULL) const = 0;
 };
 
 template<class PT>
@@ -33,17 +98,29 @@ class ListScheduler: public BasicListScheduler
 	Schedule process(const layout_t &layout, const priority_t &priority,
 		void *data = NULL) const;
 
-	protected:
-
-	inline bool ready(const Task *task, const bit_string_t &scheduled) const
+	inline void process_into(const layout_t &layout, const priority_t &priority,
+		Schedule &schedule, SchedulerWorkspace &workspace,
+		void *data = NULL) const
 	{
-		size_t parent_count = task->parents.size();
+		process_into(layout, priority, schedule, workspace, NULL, NULL, data);
+	}
 
-		for (size_t i = 0; i < parent_count; i++)
-			if (!scheduled[task->parents[i]->id]) return false;
+	void process_into(const layout_t &layout, const priority_t &priority,
+		Schedule &schedule, SchedulerWorkspace &workspace,
+		const ScheduleTrail *previous, ScheduleTrail *trail,
+		void *data = NULL) const;
 
-		return true;
-	}
+	protected:
+
+	/* Restores the state of the last suitable checkpoint of the previous
+	 * trail, returns the number of the steps done, zero if none fits.
+	 */
+	size_t resume(const layout_t &layout, const priority_t &priority,
+		Schedule &schedule, SchedulerWorkspace &workspace, PT &pool,
+		const ScheduleTrail &previous, ScheduleTrail *trail) const;
+
+	void record(size_t step, const SchedulerWorkspace &workspace,
+		const PT &pool, ScheduleTrail &trail) const;
 };
 
 typedef ListScheduler<DeterministicPool> DeterministicListScheduler;
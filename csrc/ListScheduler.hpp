@@ -1,34 +1,93 @@
 #include "ListScheduler.h"
 
+#define UNTOUCHED ((size_t)-1)
+
 template<class PT>
 Schedule ListScheduler<PT>::process(const layout_t &layout,
 	const priority_t &priority, void *data) const
+{
+	Schedule schedule;
+	SchedulerWorkspace workspace;
+
+	process_into(layout, priority, schedule, workspace, data);
+
+	return schedule;
+}
+
+template<class PT>
+void ListScheduler<PT>::process_into(const layout_t &layout,
+	const priority_t &priority, Schedule &schedule,
+	SchedulerWorkspace &workspace, const ScheduleTrail *previous,
+	ScheduleTrail *trail, void *data) const
 {
 	tid_t id, cid;
 	pid_t pid;
 	const Task *task, *child;
 	const Processor *processor;
-	size_t i, count;
+	size_t i, count, step = 0;
 	double start, duration, finish;
 
 	size_t processor_count = processors.size();
 	size_t task_count = tasks.size();
 
-	PT pool(processors, tasks, layout, priority, data);
+	if (!workspace.pool || workspace.owner != this ||
+		typeid(*workspace.pool) != typeid(PT)) {
+
+		__DELETE(workspace.pool);
+		workspace.pool = new PT(processors, tasks);
+		workspace.owner = this;
+	}
 
-	bit_string_t &processed = pool.processed;
-	bit_string_t &scheduled = pool.scheduled;
+	PT &pool = *static_cast<PT *>(workspace.pool);
+	pool.reset(layout, priority, data);
 
 	vector_t &processor_time = pool.processor_time;
 	vector_t &task_time = pool.task_time;
 
-	Schedule schedule(processor_count, task_count);
+	schedule.reset(processor_count, task_count);
 
-	for (id = 0; id < task_count; id++) {
-		task = tasks[id];
-		if (task->is_root()) {
-			pool.push(id);
-			processed[id] = true;
+	std::vector<size_t> &remaining = workspace.remaining;
+	remaining.resize(task_count);
+
+	if (!pool.resumable()) {
+		/* Nothing is recorded, so the trail should not match anything */
+		if (trail) trail->order.clear();
+		previous = trail = NULL;
+	}
+
+	std::vector<tid_t> &touched = workspace.touched;
+	std::vector<size_t> &position = workspace.position;
+
+	if (trail) {
+		touched.clear();
+		position.assign(task_count, UNTOUCHED);
+	}
+
+	/* NOTE: the previous trail can be the new one itself */
+	if (previous)
+		step = resume(layout, priority, schedule, workspace, pool,
+			*previous, trail);
+
+	if (trail) {
+		trail->layout = layout;
+		trail->priority = priority;
+		trail->order.resize(task_count);
+		trail->step.resize(task_count);
+		trail->born.resize(task_count);
+		trail->mapping.resize(task_count);
+		trail->start.resize(task_count);
+
+		if (step == 0) trail->checkpoint_count = 0;
+	}
+
+	if (step == 0) {
+		for (id = 0; id < task_count; id++) {
+			task = tasks[id];
+			remaining[id] = task->parents.size();
+			if (task->is_root()) {
+				pool.push(id);
+				if (trail) trail->born[id] = 0;
+			}
 		}
 	}
 
@@ -53,10 +112,27 @@ Schedule ListScheduler<PT>::process(const layout_t &layout,
 
 		/* Append to the schedule */
 		schedule.append(pid, id, start, duration);
-		scheduled[id] = true;
+
+		if (trail) {
+			trail->order[step] = id;
+			trail->step[id] = step;
+			trail->mapping[id] = pid;
+			trail->start[id] = start;
+
+			/* Not touched anymore */
+			if (position[id] != UNTOUCHED) {
+				tid_t last = touched.back();
+				touched[position[id]] = last;
+				position[last] = position[id];
+				touched.pop_back();
+				position[id] = UNTOUCHED;
+			}
+		}
+
+		step++;
 
 		/* Append children, but only those which are ready,
-		 * and ensure absence of repetitions.
+		 * i.e., once their last parent is scheduled.
 		 */
 		count = task->children.size();
 		for (i = 0; i < count; i++) {
@@ -66,16 +142,163 @@ Schedule ListScheduler<PT>::process(const layout_t &layout,
 			/* Shift the child in time with respect to the parent */
 			task_time[cid] = std::max(task_time[cid], finish);
 
-			/* Prevent from considering the child once again */
-			if (processed[cid]) continue;
+			if (trail && position[cid] == UNTOUCHED) {
+				position[cid] = touched.size();
+				touched.push_back(cid);
+			}
+
+			if (--remaining[cid] == 0) {
+				pool.push(cid);
+				if (trail) trail->born[cid] = step;
+			}
+		}
+
+		if (trail && step % trail->interval == 0 && step < task_count)
+			record(step, workspace, pool, *trail);
+	}
+}
+
+template<class PT>
+size_t ListScheduler<PT>::resume(const layout_t &layout,
+	const priority_t &priority, Schedule &schedule,
+	SchedulerWorkspace &workspace, PT &pool,
+	const ScheduleTrail &previous, ScheduleTrail *trail) const
+{
+	size_t i;
+
+	const size_t task_count = tasks.size();
+
+	if (previous.order.size() != task_count ||
+		previous.priority.size() != priority.size() ||
+		previous.layout.size() != layout.size() ||
+		previous.checkpoint_count == 0) return 0;
+
+	/* The number of the steps that stay the same */
+	size_t limit = task_count;
+
+	for (i = 0; i < priority.size(); i++)
+		if (priority[i] != previous.priority[i])
+			limit = std::min(limit, previous.born[i]);
+
+	for (i = 0; i < layout.size(); i++)
+		if (layout[i] != previous.layout[i])
+			limit = std::min(limit, previous.step[i]);
 
-			/* All parents should be scheduled */
-			if (!ready(child, scheduled)) continue;
+	size_t index = previous.checkpoint_count;
+	while (index > 0 && previous.checkpoints[index - 1].step > limit) index--;
 
-			pool.push(cid);
-			processed[cid] = true;
+	if (index == 0) return 0;
+
+	const ScheduleTrail::checkpoint_t &checkpoint =
+		previous.checkpoints[index - 1];
+
+	const size_t step = checkpoint.step;
+
+	std::vector<size_t> &remaining = workspace.remaining;
+	vector_t &processor_time = pool.processor_time;
+	vector_t &task_time = pool.task_time;
+
+	/* Written over in place, the trail already has everything before
+	 * the step, and whatever comes after is written over.
+	 */
+	ScheduleTrail *copy = trail == &previous ? NULL : trail;
+
+	if (copy) {
+		copy->order.resize(task_count);
+		copy->step.resize(task_count);
+		copy->born.resize(task_count);
+		copy->mapping.resize(task_count);
+		copy->start.resize(task_count);
+	}
+
+	/* The steps done */
+	for (i = 0; i < step; i++) {
+		tid_t id = previous.order[i];
+		pid_t pid = previous.mapping[id];
+
+		schedule.append(pid, id, previous.start[id],
+			processors[pid]->calc_duration(tasks[id]->get_type()));
+
+		if (copy) {
+			copy->order[i] = id;
+			copy->step[id] = previous.step[id];
+			copy->born[id] = previous.born[id];
+			copy->mapping[id] = pid;
+			copy->start[id] = previous.start[id];
 		}
 	}
 
-	return schedule;
+	for (i = 0; i < processors.size(); i++)
+		processor_time[i] = checkpoint.processor_time[i];
+
+	for (i = 0; i < task_count; i++)
+		remaining[i] = tasks[i]->parents.size();
+
+	for (i = 0; i < checkpoint.touched.size(); i++) {
+		tid_t id = checkpoint.touched[i];
+		remaining[id] = checkpoint.remaining[i];
+		task_time[id] = checkpoint.task_time[i];
+	}
+
+	for (i = 0; i < checkpoint.ready.size(); i++) {
+		tid_t id = checkpoint.ready[i];
+		pool.push(id);
+		if (copy) copy->born[id] = previous.born[id];
+	}
+
+	if (trail) {
+		std::vector<tid_t> &touched = workspace.touched;
+		std::vector<size_t> &position = workspace.position;
+
+		for (i = 0; i < checkpoint.touched.size(); i++) {
+			tid_t id = checkpoint.touched[i];
+			position[id] = touched.size();
+			touched.push_back(id);
+		}
+
+		if (copy) {
+			if (copy->checkpoints.size() < index)
+				copy->checkpoints.resize(index);
+
+			for (i = 0; i < index; i++)
+				copy->checkpoints[i] = previous.checkpoints[i];
+		}
+
+		trail->checkpoint_count = index;
+	}
+
+	return step;
+}
+
+template<class PT>
+void ListScheduler<PT>::record(size_t step,
+	const SchedulerWorkspace &workspace, const PT &pool,
+	ScheduleTrail &trail) const
+{
+	const std::vector<tid_t> &touched = workspace.touched;
+	const size_t touched_count = touched.size();
+	const size_t processor_count = processors.size();
+
+	if (trail.checkpoint_count == trail.checkpoints.size())
+		trail.checkpoints.push_back(ScheduleTrail::checkpoint_t());
+
+	ScheduleTrail::checkpoint_t &checkpoint =
+		trail.checkpoints[trail.checkpoint_count++];
+
+	checkpoint.step = step;
+
+	pool.save(checkpoint.ready);
+
+	checkpoint.processor_time.resize(processor_count);
+	for (size_t i = 0; i < processor_count; i++)
+		checkpoint.processor_time[i] = pool.processor_time[i];
+
+	checkpoint.touched = touched;
+	checkpoint.remaining.resize(touched_count);
+	checkpoint.task_time.resize(touched_count);
+
+	for (size_t i = 0; i < touched_count; i++) {
+		checkpoint.remaining[i] = workspace.remaining[touched[i]];
+		checkpoint.task_time[i] = pool.task_time[touched[i]];
+	}
 }
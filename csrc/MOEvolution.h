@@ -93,15 +93,16 @@ class MOEvolution:
 {
 	protected:
 
-	class evaluate_t: public moeoEvalFunc<chromosome_t>
+	class evaluate_t: public eoPopEvalFunc<chromosome_t>
 	{
 		public:
 
 		evaluate_t(MOEvolution &_evolution) : evolution(_evolution) {}
 
-		void operator()(chromosome_t &chromosome)
+		void operator()(eoPop<chromosome_t> &parents,
+			eoPop<chromosome_t> &offspring)
 		{
-			evolution.evaluate(chromosome);
+			evolution.evaluate(offspring);
 		}
 
 		private:
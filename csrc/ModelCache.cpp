@@ -0,0 +1,158 @@
+#include <sstream>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ModelCache.h"
+
+#define MODEL_CACHE_VERSION 1
+
+std::string ModelCache::directory;
+
+struct model_header_t
+{
+	char magic[8];
+	uint64_t version;
+	uint64_t node_count;
+};
+
+/* FNV-1a */
+static uint64_t digest(uint64_t key, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+
+	for (size_t i = 0; i < size; i++) {
+		key ^= bytes[i];
+		key *= 1099511628211ULL;
+	}
+
+	return key;
+}
+
+ModelCache::ModelCache(size_t _node_count, size_t processor_count,
+	double sampling_interval, const double **conductivity,
+	const double *capacitance) : node_count(_node_count)
+{
+	if (directory.empty()) return;
+
+	uint64_t key = 14695981039346656037ULL;
+	uint64_t count;
+
+	count = node_count;
+	key = digest(key, &count, sizeof(count));
+	count = processor_count;
+	key = digest(key, &count, sizeof(count));
+	key = digest(key, &sampling_interval, sizeof(sampling_interval));
+
+	for (size_t i = 0; i < node_count; i++)
+		key = digest(key, conductivity[i], sizeof(double) * node_count);
+
+	key = digest(key, capacitance, sizeof(double) * node_count);
+
+	std::stringstream stream;
+	stream << directory << "/" << std::hex << std::setw(16)
+		<< std::setfill('0') << key << ".model";
+
+	filename = stream.str();
+}
+
+bool ModelCache::load(vector_t &L, matrix_t &U, matrix_t &K,
+	matrix_t &G) const
+{
+	if (filename.empty()) return false;
+
+	const size_t size = sizeof(model_header_t) +
+		sizeof(double) * node_count * (1 + 3 * node_count);
+
+	int file = open(filename.c_str(), O_RDONLY);
+
+	if (file < 0) return false;
+
+	struct stat info;
+
+	if (fstat(file, &info) || (size_t)info.st_size != size) {
+		close(file);
+		return false;
+	}
+
+	void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+	close(file);
+
+	if (data == MAP_FAILED) return false;
+
+	const model_header_t *header = (const model_header_t *)data;
+
+	/* The hash is in the name, the rest is just a precaution */
+	if (memcmp(header->magic, "SDTAMDL", 8) ||
+		header->version != MODEL_CACHE_VERSION ||
+		header->node_count != node_count) {
+
+		munmap(data, size);
+		return false;
+	}
+
+	const double *values = (const double *)(header + 1);
+
+	__MEMCPY(L, values, node_count);
+	values += node_count;
+	__MEMCPY(U, values, node_count * node_count);
+	values += node_count * node_count;
+	__MEMCPY(K, values, node_count * node_count);
+	values += node_count * node_count;
+	__MEMCPY(G, values, node_count * node_count);
+
+	munmap(data, size);
+
+	return true;
+}
+
+void ModelCache::save(const vector_t &L, const matrix_t &U,
+	const matrix_t &K, const matrix_t &G) const
+{
+	if (filename.empty()) return;
+
+	model_header_t header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SDTAMDL", 8);
+	header.version = MODEL_CACHE_VERSION;
+	header.node_count = node_count;
+
+	/* Several processes might be writing the same model at once,
+	 * hence, the file appears under its name only when it is complete.
+	 */
+	std::stringstream stream;
+	stream << filename << "." << getpid() << ".tmp";
+
+	std::string temporary = stream.str();
+
+	FILE *file = fopen(temporary.c_str(), "wb");
+
+	bool good = file != NULL;
+
+	if (good) {
+		good =
+			fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(L, sizeof(double), node_count, file) == node_count &&
+			fwrite(U, sizeof(double), node_count * node_count, file) ==
+				node_count * node_count &&
+			fwrite(K, sizeof(double), node_count * node_count, file) ==
+				node_count * node_count &&
+			fwrite(G, sizeof(double), node_count * node_count, file) ==
+				node_count * node_count;
+
+		good = !fclose(file) && good;
+	}
+
+	/* The cache is only a shortcut, the model is there anyway */
+	if (!good || rename(temporary.c_str(), filename.c_str())) {
+		unlink(temporary.c_str());
+		std::cerr << "Cannot write the model cache to " << filename
+			<< ", continuing without it." << std::endl;
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef __MODEL_CACHE_H__
+#define __MODEL_CACHE_H__
+
+#include "common.h"
+
+/* Keeps the eigenvalue decomposition of the thermal model together with
+ * the matrix exponent K and the coefficient matrix G on the disk.
+ * The files are named after a hash of everything they depend on, i.e.,
+ * the conductance and capacitance of the RC circuit, the number of
+ * processors, and the sampling interval.
+ */
+class ModelCache
+{
+	static std::string directory;
+
+	const size_t node_count;
+	std::string filename;
+
+	public:
+
+	/* NOTE: an empty directory disables the cache */
+	static void set_directory(const std::string &directory)
+	{
+		ModelCache::directory = directory;
+	}
+
+	ModelCache(size_t _node_count, size_t processor_count,
+		double sampling_interval, const double **conductivity,
+		const double *capacitance);
+
+	bool load(vector_t &L, matrix_t &U, matrix_t &K, matrix_t &G) const;
+	void save(const vector_t &L, const matrix_t &U, const matrix_t &K,
+		const matrix_t &G) const;
+};
+
+#endif
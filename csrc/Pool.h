@@ -5,26 +5,215 @@
 #include "GraphAnalysis.h"
 #include "Hotspot.h"
 
-class Pool: public std::list<tid_t>
+/* The ready tasks ordered by their priority and, among the equal ones,
+ * by the time they were pushed, i.e., in the same order as the sorted
+ * insertion into a list gives, but kept in a binary heap.
+ */
+class PriorityQueue
+{
+	struct item_t
+	{
+		rank_t priority;
+		size_t order;
+		tid_t id;
+
+		/* NOTE: reversed since the heap keeps the largest on the top */
+		inline bool operator<(const item_t &another) const
+		{
+			if (priority != another.priority)
+				return another.priority < priority;
+			return another.order < order;
+		}
+	};
+
+	std::vector<item_t> heap;
+	size_t order;
+
+	public:
+
+	PriorityQueue(size_t capacity) : order(0)
+	{
+		heap.reserve(capacity);
+	}
+
+	inline bool empty() const
+	{
+		return heap.empty();
+	}
+
+	inline size_t size() const
+	{
+		return heap.size();
+	}
+
+	inline void push(tid_t id, rank_t priority)
+	{
+		item_t item;
+
+		item.priority = priority;
+		item.order = order++;
+		item.id = id;
+
+		heap.push_back(item);
+		std::push_heap(heap.begin(), heap.end());
+	}
+
+	inline void clear()
+	{
+		heap.clear();
+		order = 0;
+	}
+
+	/* The tasks in the order they were pushed */
+	inline void save(std::vector<tid_t> &ready) const
+	{
+		std::vector<std::pair<size_t, tid_t> > items(heap.size());
+
+		for (size_t i = 0; i < heap.size(); i++)
+			items[i] = std::make_pair(heap[i].order, heap[i].id);
+
+		std::sort(items.begin(), items.end());
+
+		ready.resize(items.size());
+		for (size_t i = 0; i < items.size(); i++)
+			ready[i] = items[i].second;
+	}
+
+	inline tid_t pop()
+	{
+		tid_t id = heap.front().id;
+
+		std::pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+
+		return id;
+	}
+};
+
+/* The ready tasks in the order of a list where every new task goes to
+ * the front, with the access by the position in logarithmic time.
+ * The tasks are laid out from the end backwards as they come, and
+ * a Fenwick tree over the layout counts those still present.
+ */
+class RandomQueue
+{
+	std::vector<tid_t> tasks;
+	std::vector<size_t> tree;
+
+	size_t pushed;
+	size_t count;
+
+	public:
+
+	RandomQueue(size_t capacity) :
+		tasks(capacity), tree(capacity + 1, 0), pushed(0), count(0) {}
+
+	inline bool empty() const
+	{
+		return count == 0;
+	}
+
+	inline size_t size() const
+	{
+		return count;
+	}
+
+	inline void clear()
+	{
+		std::fill(tree.begin(), tree.end(), 0);
+		pushed = 0;
+		count = 0;
+	}
+
+	inline void push(tid_t id)
+	{
+		size_t position = tasks.size() - ++pushed;
+
+		tasks[position] = id;
+		update(position, 1);
+		count++;
+	}
+
+	inline tid_t pull(size_t index)
+	{
+		size_t position = 0;
+		size_t step = 1;
+
+		while (2 * step < tree.size()) step *= 2;
+
+		/* Descend to the position with exactly index tasks before it */
+		for (; step; step /= 2)
+			if (position + step < tree.size() &&
+				tree[position + step] <= index) {
+
+				position += step;
+				index -= tree[position];
+			}
+
+		update(position, -1);
+		count--;
+
+		return tasks[position];
+	}
+
+	private:
+
+	inline void update(size_t position, int delta)
+	{
+		for (size_t i = position + 1; i < tree.size(); i += i & (~i + 1))
+			tree[i] += delta;
+	}
+};
+
+/* A pool is made once for a scheduler and a workspace, everything that
+ * depends only on the architecture and the graph is computed then,
+ * and it is reset before every scheduling.
+ */
+class Pool
 {
 	template<class PT>
 	friend class ListScheduler;
 
 	public:
 
-	Pool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	Pool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
 
 		processor_count(_processors.size()), task_count(_tasks.size()),
 		processor_time(processor_count, 0), task_time(task_count, 0),
-		processed(task_count, false), scheduled(task_count, false),
-		layout(_layout), priority(_priority)
+		layout(NULL), priority(NULL)
+	{
+	}
+
+	virtual ~Pool() {}
+
+	virtual void reset(const layout_t &_layout, const priority_t &_priority,
+		void *_data = NULL)
 	{
+		layout = &_layout;
+		priority = &_priority;
+
+		processor_time.nullify();
+		task_time.nullify();
 	}
 
+	virtual bool empty() const = 0;
 	virtual void push(tid_t id) = 0;
 	virtual void pull(pid_t &pid, tid_t &id) = 0;
 
+	/* Whether the choices depend only on the layout, the priority, and
+	 * the times above, so that the pool can be restored by pushing
+	 * the saved tasks once again.
+	 */
+	virtual bool resumable() const
+	{
+		return false;
+	}
+
+	virtual void save(std::vector<tid_t> &ready) const
+	{
+		throw std::runtime_error("The pool cannot be saved.");
+	}
+
 	protected:
 
 	const size_t processor_count;
@@ -33,93 +222,114 @@ class Pool: public std::list<tid_t>
 	vector_t processor_time;
 	vector_t task_time;
 
-	bit_string_t processed;
-	bit_string_t scheduled;
-
-	const layout_t &layout;
-	const priority_t &priority;
+	const layout_t *layout;
+	const priority_t *priority;
 };
 
 class DeterministicPool: public Pool
 {
 	public:
 
-	DeterministicPool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	DeterministicPool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
 
-		Pool(_processors, _tasks, _layout, _priority, _data) {}
+		Pool(_processors, _tasks), queue(task_count) {}
 
-	virtual inline void push(tid_t id)
+	virtual void reset(const layout_t &_layout, const priority_t &_priority,
+		void *_data = NULL)
 	{
-		iterator it;
-		rank_t new_priority = priority[id];
+		Pool::reset(_layout, _priority, _data);
+		queue.clear();
+	}
 
-		for (it = begin(); it != end(); it++)
-			if (new_priority < priority[*it]) break;
+	virtual inline bool empty() const
+	{
+		return queue.empty();
+	}
 
-		insert(it, id);
+	virtual inline void push(tid_t id)
+	{
+		queue.push(id, (*priority)[id]);
 	}
 
 	virtual inline void pull(pid_t &pid, tid_t &id)
 	{
-		id = front();
-		pid = layout[id];
+		id = queue.pop();
+		pid = (*layout)[id];
+	}
+
+	virtual bool resumable() const
+	{
+		return true;
+	}
 
-		pop_front();
+	virtual void save(std::vector<tid_t> &ready) const
+	{
+		queue.save(ready);
 	}
+
+	protected:
+
+	PriorityQueue queue;
 };
 
 class RandomPool: public Pool
 {
 	public:
 
-	RandomPool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	RandomPool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
 
-		Pool(_processors, _tasks, _layout, _priority, _data) {}
+		Pool(_processors, _tasks), ordered(task_count), unordered(task_count) {}
 
-	virtual void push(tid_t id)
+	virtual void reset(const layout_t &_layout, const priority_t &_priority,
+		void *_data = NULL)
 	{
-		iterator it = begin();
-
-		if (!priority.empty()) {
-			/* Deterministic scheduling */
-			rank_t new_priority = priority[id];
-			for (; it != end(); it++)
-				if (new_priority < priority[*it]) break;
-		}
-		/* else (Random scheduling) */
+		Pool::reset(_layout, _priority, _data);
 
-		insert(it, id);
+		if (priority->empty()) unordered.clear();
+		else ordered.clear();
 	}
 
-	virtual void pull(pid_t &pid, tid_t &id)
+	virtual inline bool empty() const
 	{
-		iterator it = begin();
+		return ordered.empty() && unordered.empty();
+	}
 
-		if (priority.empty()) {
+	virtual void push(tid_t id)
+	{
+		if (!priority->empty())
+			/* Deterministic scheduling */
+			ordered.push(id, (*priority)[id]);
+		else
 			/* Random scheduling */
-			size_t choice = Random::number(size());
-			for (size_t i = 0; i < choice; i++) it++;
-		}
-		/* else (Deterministic scheduling) */
+			unordered.push(id);
+	}
 
-		id = *it;
-		if (layout.empty()) pid = Random::number(processor_count);
-		else pid = layout[id];
+	virtual void pull(pid_t &pid, tid_t &id)
+	{
+		if (priority->empty())
+			/* Random scheduling */
+			id = unordered.pull(Random::number(unordered.size()));
+		else
+			/* Deterministic scheduling */
+			id = ordered.pop();
 
-		erase(it);
+		if (layout->empty()) pid = Random::number(processor_count);
+		else pid = (*layout)[id];
 	}
+
+	private:
+
+	PriorityQueue ordered;
+	RandomQueue unordered;
 };
 
 class EarliestProcessorPool: public DeterministicPool
 {
 	public:
 
-	EarliestProcessorPool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	EarliestProcessorPool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
 
-		DeterministicPool(_processors, _tasks, _layout, _priority, _data) {}
+		DeterministicPool(_processors, _tasks) {}
 
 	virtual void pull(pid_t &pid, tid_t &id)
 	{
@@ -129,10 +339,8 @@ class EarliestProcessorPool: public DeterministicPool
 			if (processor_time[earliest] > processor_time[i])
 				earliest = i;
 
-		id = front();
+		id = queue.pop();
 		pid = earliest;
-
-		pop_front();
 	}
 };
 
@@ -140,6 +348,9 @@ class CriticalityPool: public Pool
 {
 	protected:
 
+	/* In the order of arrival */
+	std::vector<tid_t> ready;
+
 	vector_t sc;
 
 	const processor_vector_t &processors;
@@ -149,12 +360,18 @@ class CriticalityPool: public Pool
 	matrix_t time;
 	vector_t energy;
 
+	/* The dynamic criticality without the additional cost and
+	 * the additional cost of each candidate, the processors of
+	 * the ready tasks one after another.
+	 */
+	vector_t criticality;
+	vector_t cost;
+
 	public:
 
-	CriticalityPool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	CriticalityPool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
 
-		Pool(_processors, _tasks, _layout, _priority, _data),
+		Pool(_processors, _tasks),
 		processors(_processors), tasks(_tasks)
 	{
 		sc = GraphAnalysis::statical_criticality(processors, tasks);
@@ -169,52 +386,82 @@ class CriticalityPool: public Pool
 				time[i][j] = processors[j]->calc_duration(type);
 			}
 		}
+
+		ready.reserve(task_count);
+
+		criticality.resize(task_count * processor_count);
+		cost.resize(task_count * processor_count);
+	}
+
+	virtual void reset(const layout_t &_layout, const priority_t &_priority,
+		void *_data = NULL)
+	{
+		Pool::reset(_layout, _priority, _data);
+		ready.clear();
+	}
+
+	virtual inline bool empty() const
+	{
+		return ready.empty();
 	}
 
 	virtual inline void push(tid_t id)
 	{
-		push_back(id);
+		ready.push_back(id);
 	}
 
 	virtual void pull(pid_t &best_pid, tid_t &best_id)
 	{
-		iterator best_it;
-		double dc, max_dc = -DBL_MAX;
-		best_pid = best_id = 0;
+		size_t i, k, best = 0;
+		const size_t ready_count = ready.size();
+		const size_t count = ready_count * processor_count;
+
+		double *dc = criticality;
 
 		/* For all tasks in the pool */
-		for (iterator it = begin(); it != end(); it++) {
-			tid_t id = *it;
-			for (pid_t pid = 0; pid < processor_count; pid++) {
-				/* 1. Statical criticality */
-				dc = sc[id];
-				/* 2. Worst case execution time */
-				dc -= time[id][pid];
-				/* 3. Earliest start time */
-				dc -= std::max(processor_time[pid], task_time[id]);
-				/* 4. Some additional cost */
-				dc -= estimate_cost(pid, id);
-
-				if (dc > max_dc) {
-					max_dc = dc;
-
-					best_pid = pid;
-					best_id = id;
-					best_it = it;
-				}
+		for (i = 0, k = 0; i < ready_count; i++) {
+			const tid_t id = ready[i];
+			const double *_time = time[id];
+
+			for (pid_t pid = 0; pid < processor_count; pid++, k++)
+				/* 1. Statical criticality
+				 * 2. Worst case execution time
+				 * 3. Earliest start time
+				 */
+				dc[k] = sc[id] - _time[pid] -
+					std::max(processor_time[pid], task_time[id]);
+		}
+
+		/* 4. Some additional cost */
+		estimate_costs(cost);
+
+		/* The first of the largest, in the same order as above */
+		double max_dc = -DBL_MAX;
+
+		for (k = 0; k < count; k++) {
+			dc[k] -= cost[k];
+			if (dc[k] > max_dc) {
+				max_dc = dc[k];
+				best = k;
 			}
 		}
 
+		best_pid = best % processor_count;
+		best_id = ready[best / processor_count];
+
 		confirm_cost(best_pid, best_id);
 
-		erase(best_it);
+		ready.erase(ready.begin() + best / processor_count);
 	}
 
 	protected:
 
-	virtual inline double estimate_cost(pid_t pid, tid_t id)
+	/* The additional cost of all the candidates at once, laid out as
+	 * the criticality is.
+	 */
+	virtual void estimate_costs(double *cost)
 	{
-		return 0;
+		__NULLIFY(cost, ready.size() * processor_count);
 	}
 
 	virtual inline void confirm_cost(pid_t pid, tid_t id)
@@ -239,15 +486,21 @@ class PowerCriticalityPool: public CriticalityPool
 
 	public:
 
-	PowerCriticalityPool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	PowerCriticalityPool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
 
-		CriticalityPool(_processors, _tasks, _layout, _priority, _data)
+		CriticalityPool(_processors, _tasks), data(NULL)
+	{
+		energy.resize(processor_count);
+	}
+
+	virtual void reset(const layout_t &_layout, const priority_t &_priority,
+		void *_data = NULL)
 	{
 		if (!_data)
 			throw std::runtime_error("The data is null.");
 
-		energy.resize(processor_count);
+		CriticalityPool::reset(_layout, _priority, _data);
+
 		energy.nullify();
 
 		data = (data_t *)_data;
@@ -255,11 +508,21 @@ class PowerCriticalityPool: public CriticalityPool
 
 	protected:
 
-	virtual inline double estimate_cost(pid_t pid, tid_t id)
+	virtual void estimate_costs(double *cost)
 	{
-		double total_time = std::max(processor_time[pid], task_time[id]) + time[id][pid];
-		double total_energy = energy[pid] + time[id][pid] * power[id][pid];
-		return data->coefficient * total_energy / total_time;
+		const size_t ready_count = ready.size();
+
+		for (size_t i = 0, k = 0; i < ready_count; i++) {
+			const tid_t id = ready[i];
+			const double *_time = time[id];
+			const double *_power = power[id];
+
+			for (pid_t pid = 0; pid < processor_count; pid++, k++) {
+				double total_time = std::max(processor_time[pid], task_time[id]) + _time[pid];
+				double total_energy = energy[pid] + _time[pid] * _power[pid];
+				cost[k] = data->coefficient * total_energy / total_time;
+			}
+		}
 	}
 
 	virtual inline void confirm_cost(pid_t pid, tid_t id)
@@ -268,6 +531,15 @@ class PowerCriticalityPool: public CriticalityPool
 	}
 };
 
+/* The steady-state temperature is affine in the power, T = T0 + Q * P,
+ * where Q is the response of the processors to the power of each of them,
+ * probed from the given hotspot on every reset, since nothing tells
+ * whether the hotspot is still the one probed before. Then Q * energy
+ * is kept up to date, and a candidate, which adds to the energy of one
+ * processor, is assessed with one column of Q instead of a whole
+ * solution. If the hotspot turns out not to be affine, every candidate
+ * is solved as is.
+ */
 class TemperatureCriticalityPool: public CriticalityPool
 {
 	public:
@@ -287,31 +559,102 @@ class TemperatureCriticalityPool: public CriticalityPool
 
 	data_t *data;
 
+	bool affine;
+
+	/* T0, the transposed Q, and Q * energy */
+	vector_t ambient;
+	matrix_t response;
+	vector_t heat;
+
 	public:
 
-	TemperatureCriticalityPool(const processor_vector_t &_processors, const task_vector_t &_tasks,
-		const layout_t &_layout, const priority_t &_priority, void *_data = NULL) :
+	TemperatureCriticalityPool(const processor_vector_t &_processors, const task_vector_t &_tasks) :
+
+		CriticalityPool(_processors, _tasks), data(NULL), affine(false)
+	{
+		energy.resize(processor_count);
+		average_power.resize(1, processor_count);
 
-		CriticalityPool(_processors, _tasks, _layout, _priority, _data)
+		ambient.resize(processor_count);
+		response.resize(processor_count, processor_count);
+		heat.resize(processor_count);
+	}
+
+	virtual void reset(const layout_t &_layout, const priority_t &_priority,
+		void *_data = NULL)
 	{
 		if (!_data)
 			throw std::runtime_error("The data is null.");
 
-		energy.resize(processor_count);
-		energy.nullify();
+		CriticalityPool::reset(_layout, _priority, _data);
 
-		average_power.resize(1, processor_count);
+		energy.nullify();
+		heat.nullify();
 
 		data = (data_t *)_data;
+
+		probe();
 	}
 
 	protected:
 
-	virtual inline double estimate_cost(pid_t pid, tid_t id)
+	virtual void estimate_costs(double *cost)
 	{
-		double total_time = std::max(processor_time[pid], task_time[id]) + time[id][pid];
+		const size_t ready_count = ready.size();
+
+		for (size_t i = 0, k = 0; i < ready_count; i++) {
+			const tid_t id = ready[i];
+
+			if (!affine) {
+				for (pid_t pid = 0; pid < processor_count; pid++, k++)
+					cost[k] = solve_cost(pid, id);
+				continue;
+			}
+
+			const double *_time = time[id];
+			const double *_power = power[id];
+
+			for (pid_t pid = 0; pid < processor_count; pid++, k++) {
+				const double total_time = std::max(processor_time[pid],
+					task_time[id]) + _time[pid];
+				const double added = _time[pid] * _power[pid];
+				const double *column = response[pid];
+
+				double Tmax = -DBL_MAX;
+
+				for (size_t j = 0; j < processor_count; j++)
+					Tmax = std::max(Tmax,
+						ambient[j] + (heat[j] + column[j] * added) / total_time);
+
+				cost[k] = data->coefficient * Tmax;
+			}
+		}
+	}
+
+	virtual inline void confirm_cost(pid_t pid, tid_t id)
+	{
+		double added = time[id][pid] * power[id][pid];
+
+		energy[pid] += added;
+
+		if (!affine) return;
+
+		const double *column = response[pid];
 
 		for (size_t i = 0; i < processor_count; i++)
+			heat[i] += column[i] * added;
+	}
+
+	private:
+
+	/* The cost with a whole solution, when the hotspot is not affine */
+	double solve_cost(pid_t pid, tid_t id)
+	{
+		size_t i;
+		double total_time = std::max(processor_time[pid], task_time[id]) + time[id][pid];
+		double Tmax = -DBL_MAX;
+
+		for (i = 0; i < processor_count; i++)
 			if (i == pid)
 				average_power[0][i] = (energy[i] + time[id][i] * power[id][i]) / total_time;
 			else
@@ -319,17 +662,51 @@ class TemperatureCriticalityPool: public CriticalityPool
 
 		data->hotspot->solve(average_power, temperature);
 
-		double Tmax = -DBL_MAX;
-
-		for (size_t i = 0; i < processor_count; i++)
+		for (i = 0; i < processor_count; i++)
 			if (temperature[0][i] > Tmax) Tmax = temperature[0][i];
 
 		return data->coefficient * Tmax;
 	}
 
-	virtual inline void confirm_cost(pid_t pid, tid_t id)
+	void probe()
 	{
-		energy[pid] += time[id][pid] * power[id][pid];
+		size_t i, j;
+
+		/* No power at all */
+		average_power.nullify();
+		data->hotspot->solve(average_power, temperature);
+
+		for (i = 0; i < processor_count; i++)
+			ambient[i] = temperature[0][i];
+
+		/* One watt on one processor at a time */
+		for (j = 0; j < processor_count; j++) {
+			average_power.nullify();
+			average_power[0][j] = 1;
+
+			data->hotspot->solve(average_power, temperature);
+
+			for (i = 0; i < processor_count; i++)
+				response[j][i] = temperature[0][i] - ambient[i];
+		}
+
+		/* One watt everywhere should be the sum of the above */
+		for (j = 0; j < processor_count; j++)
+			average_power[0][j] = 1;
+
+		data->hotspot->solve(average_power, temperature);
+
+		affine = true;
+
+		for (i = 0; i < processor_count && affine; i++) {
+			double expected = ambient[i];
+
+			for (j = 0; j < processor_count; j++)
+				expected += response[j][i];
+
+			if (std::abs(temperature[0][i] - expected) >
+				1e-6 * std::max(1.0, std::abs(expected))) affine = false;
+		}
 	}
 };
 
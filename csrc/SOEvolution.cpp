@@ -31,7 +31,7 @@ SOEvolutionStats &SOEvolution::solve(const layout_t &layout,
 	populate(population, layout, priority);
 #endif
 
-	evaluate_t evaluator(*this);
+	evaluate_all_t evaluator(*this);
 
 	/* Select */
 	Selection<chromosome_t> select(tuning.selection);
@@ -49,8 +49,8 @@ SOEvolutionStats &SOEvolution::solve(const layout_t &layout,
 	eslabSOEvolutionMonitor evolution_monitor(population, optimization_tuning.dump);
 	checkpoint.add(evolution_monitor);
 
-	eslabSOGeneticAlgorithm<chromosome_t> ga(checkpoint, evaluator, select,
-		transform, replace);
+	eslabSOGeneticAlgorithm<chromosome_t> ga(checkpoint, evaluator,
+		select, transform, replace);
 
 	ga(population);
 
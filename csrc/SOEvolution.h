@@ -65,18 +65,27 @@ class SOEvolution:
 {
 	protected:
 
-	class evaluate_t: public eoEvalFunc<chromosome_t>
+	class evaluate_all_t: public eslabPopEvalFunc<chromosome_t>
 	{
 		public:
 
-		evaluate_t(SOEvolution &_evolution) :
-			eoEvalFunc<chromosome_t>(), evolution(_evolution) {}
+		evaluate_all_t(SOEvolution &_evolution) :
+			eslabPopEvalFunc<chromosome_t>(), evolution(_evolution) {}
 
-		void operator()(chromosome_t &chromosome)
+		void operator()(eoPop<chromosome_t> &parents,
+			eoPop<chromosome_t> &offspring)
 		{
-			evolution.evaluate(chromosome);
+			evolution.evaluate(offspring);
 		}
 
+#ifdef PRECISE_TIMEOUT
+		bool operator()(eoPop<chromosome_t> &population,
+			const eslabCheckPoint<chromosome_t> &checkpoint)
+		{
+			return evolution.evaluate(population, checkpoint);
+		}
+#endif
+
 		private:
 
 		SOEvolution &evolution;
@@ -105,31 +114,27 @@ class eslabAlgorithm: public eoAlgo<CT>
 
 	eslabAlgorithm(
 		eslabCheckPoint<chromosome_t> &_continuator,
-		eoEvalFunc<chromosome_t> &_evaluate_one) :
+		eslabPopEvalFunc<chromosome_t> &_evaluate_all) :
 
-		continuator(_continuator), evaluate_one(_evaluate_one) {}
+		continuator(_continuator), evaluate_all(_evaluate_all) {}
 
 	protected:
 
 #ifdef PRECISE_TIMEOUT
 	inline bool evaluate(population_t &population) const
 	{
-		size_t size = population.size();
-		for (size_t i = 0; i < size; i++) {
-			if (continuator.timeout()) return false;
-			evaluate_one(population[i]);
-		}
-		return true;
+		return evaluate_all(population, continuator);
 	}
 #else
 	inline void evaluate(population_t &population) const
 	{
-		apply<chromosome_t>(evaluate_one, population);
+		population_t empty;
+		evaluate_all(empty, population);
 	}
 #endif
 
 	eslabCheckPoint<chromosome_t> &continuator;
-	eoEvalFunc<chromosome_t> &evaluate_one;
+	eslabPopEvalFunc<chromosome_t> &evaluate_all;
 };
 
 template<class CT>
@@ -142,12 +147,12 @@ class eslabSOGeneticAlgorithm: public eslabAlgorithm<CT>
 
 	eslabSOGeneticAlgorithm(
 		eslabCheckPoint<chromosome_t> &_continuator,
-		eoEvalFunc<chromosome_t> &_evaluate_one,
+		eslabPopEvalFunc<chromosome_t> &_evaluate_all,
 		eoSelect<chromosome_t> &_select,
 		eoTransform<chromosome_t> &_transform,
 		eoReplacement<chromosome_t> &_replace) :
 
-		eslabAlgorithm<chromosome_t>(_continuator, _evaluate_one),
+		eslabAlgorithm<chromosome_t>(_continuator, _evaluate_all),
 		select(_select), transform(_transform), replace(_replace) {}
 
 	void operator()(population_t &population);
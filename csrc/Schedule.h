@@ -26,6 +26,7 @@ class Schedule
 {
 	friend class GeneEncoder;
 	friend class eslabSOChromosome;
+	friend class CachedEvaluation;
 #ifndef WITHOUT_MEMCACHED
 	friend class MemcachedEvaluation;
 #endif
@@ -56,6 +57,23 @@ class Schedule
 		schedules(std::vector<LocalSchedule>(processor_count)), duration(0),
 		trace_length(2 * task_count), trace(trace_length, 0) {}
 
+	/* Starts over keeping the memory taken so far */
+	inline void reset(size_t _processor_count, size_t _task_count)
+	{
+		processor_count = _processor_count;
+		task_count = _task_count;
+		append_count = 0;
+
+		schedules.resize(processor_count);
+		for (size_t i = 0; i < processor_count; i++)
+			schedules[i].clear();
+
+		duration = 0;
+
+		trace_length = 2 * task_count;
+		trace.assign(trace_length, 0);
+	}
+
 	inline bool empty() const
 	{
 		return append_count != task_count;
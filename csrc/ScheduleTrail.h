@@ -0,0 +1,163 @@
+#ifndef __SCHEDULE_TRAIL_H__
+#define __SCHEDULE_TRAIL_H__
+
+#include <pthread.h>
+
+#include "common.h"
+
+/* The released trails kept for reuse */
+#define MAX_SPARE_TRAILS 256
+
+/* What a list scheduler went through for a layout and priority: the task
+ * of every step, the step where every task became ready, and the state
+ * of the scheduler recorded every so many steps. Another layout and
+ * priority is scheduled from the last of the checkpoints that
+ * the differences cannot affect: a priority matters only once its task
+ * is ready, and a mapping only when its task is taken.
+ *
+ * The trails are shared by the chromosomes copied from one another,
+ * hence, reference counted. The released ones are kept for reuse, so that
+ * their buffers are not allocated again for every chromosome.
+ */
+class ScheduleTrail
+{
+	template<class PT>
+	friend class ListScheduler;
+
+	public:
+
+	ScheduleTrail(size_t _interval) :
+		interval(std::max(_interval, (size_t)1)), references(1),
+		checkpoint_count(0) {}
+
+	/* One of the released trails if any, otherwise a new one */
+	static inline ScheduleTrail *create(size_t interval)
+	{
+		stock_t &stock = get_stock();
+		ScheduleTrail *trail = NULL;
+
+		pthread_mutex_lock(&stock.lock);
+
+		if (!stock.trails.empty()) {
+			trail = stock.trails.back();
+			stock.trails.pop_back();
+		}
+
+		pthread_mutex_unlock(&stock.lock);
+
+		if (!trail) return new ScheduleTrail(interval);
+
+		trail->interval = std::max(interval, (size_t)1);
+		trail->references = 1;
+		trail->order.clear();
+		trail->checkpoint_count = 0;
+
+		return trail;
+	}
+
+	static inline ScheduleTrail *acquire(ScheduleTrail *trail)
+	{
+		if (trail) __sync_fetch_and_add(&trail->references, 1);
+		return trail;
+	}
+
+	static inline void release(ScheduleTrail *trail)
+	{
+		if (trail && __sync_sub_and_fetch(&trail->references, 1) == 0)
+			recycle(trail);
+	}
+
+	/* Whether nobody else holds the trail, so that it can be written over */
+	static inline bool unique(ScheduleTrail *trail)
+	{
+		return trail && __sync_add_and_fetch(&trail->references, 0) == 1;
+	}
+
+	private:
+
+	struct stock_t
+	{
+		pthread_mutex_t lock;
+		std::vector<ScheduleTrail *> trails;
+
+		stock_t()
+		{
+			pthread_mutex_init(&lock, NULL);
+		}
+
+		~stock_t()
+		{
+			for (size_t i = 0; i < trails.size(); i++)
+				delete trails[i];
+
+			pthread_mutex_destroy(&lock);
+		}
+	};
+
+	static inline stock_t &get_stock()
+	{
+		static stock_t stock;
+		return stock;
+	}
+
+	static inline void recycle(ScheduleTrail *trail)
+	{
+		stock_t &stock = get_stock();
+
+		pthread_mutex_lock(&stock.lock);
+
+		if (stock.trails.size() < MAX_SPARE_TRAILS) {
+			stock.trails.push_back(trail);
+			trail = NULL;
+		}
+
+		pthread_mutex_unlock(&stock.lock);
+
+		delete trail;
+	}
+
+	struct checkpoint_t
+	{
+		/* The number of the steps done */
+		size_t step;
+
+		/* The pool in the order of arrival */
+		std::vector<tid_t> ready;
+
+		std::vector<double> processor_time;
+
+		/* Only the tasks with some of their parents scheduled,
+		 * the rest have all their parents to wait for and start at zero.
+		 */
+		std::vector<tid_t> touched;
+		std::vector<size_t> remaining;
+		std::vector<double> task_time;
+	};
+
+	size_t interval;
+	size_t references;
+
+	layout_t layout;
+	priority_t priority;
+
+	/* The task of every step */
+	std::vector<tid_t> order;
+
+	/* For every task, the step it is taken at, the number of the steps
+	 * done when it becomes ready, its processor, and its start.
+	 */
+	std::vector<size_t> step;
+	std::vector<size_t> born;
+	std::vector<pid_t> mapping;
+	std::vector<double> start;
+
+	/* Only the first checkpoint_count are in use, the rest keep their
+	 * buffers for the next time.
+	 */
+	std::vector<checkpoint_t> checkpoints;
+	size_t checkpoint_count;
+
+	ScheduleTrail(const ScheduleTrail &);
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include "SlotCache.h"
+
+#define SLOT_CACHE_BUCKETS 16
+
+/* The finalizer of MurmurHash3 */
+static inline uint64_t mix(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return key;
+}
+
+SlotCache::SlotCache(size_t _processor_count, size_t _type_count,
+	size_t _capacity) :
+
+	processor_count(_processor_count),
+	width(_type_count < 0xff ? 1 : (_type_count < 0xffff ? 2 : 4)),
+	key_size(processor_count * width)
+{
+	/* The buckets are at most half full */
+	const size_t entry_size = sizeof(uint64_t) + key_size +
+		processor_count * sizeof(double) + 1 + 2 * sizeof(uint32_t);
+
+	capacity = _capacity / SLOT_CACHE_SHARDS / entry_size;
+
+	for (size_t i = 0; i < SLOT_CACHE_SHARDS; i++) {
+		pthread_mutex_init(&shards[i].mutex, NULL);
+		shards[i].buckets.resize(SLOT_CACHE_BUCKETS, 0);
+		shards[i].hand = 0;
+		shards[i].hits = 0;
+		shards[i].misses = 0;
+		shards[i].evictions = 0;
+	}
+}
+
+SlotCache::~SlotCache()
+{
+	for (size_t i = 0; i < SLOT_CACHE_SHARDS; i++)
+		pthread_mutex_destroy(&shards[i].mutex);
+}
+
+void SlotCache::pack(const SlotTrace &trace, key_t &key) const
+{
+	size_t i;
+
+	key.data.resize(key_size);
+
+	unsigned char *data = &key.data[0];
+
+	/* The idle processors, -1, become zeros */
+	for (i = 0; i < processor_count; i++) {
+		uint32_t type = trace[i] + 1;
+		for (size_t j = 0; j < width; j++)
+			*(data++) = (unsigned char)(type >> (8 * j));
+	}
+
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ key_size;
+	uint64_t word;
+
+	data = &key.data[0];
+
+	for (i = 0; i + sizeof(word) <= key_size; i += sizeof(word)) {
+		memcpy(&word, data + i, sizeof(word));
+		hash = mix(hash ^ word);
+	}
+
+	if (i < key_size) {
+		word = 0;
+		memcpy(&word, data + i, key_size - i);
+		hash = mix(hash ^ word);
+	}
+
+	key.hash = hash;
+}
+
+bool SlotCache::recall(const key_t &key, double *temperature)
+{
+	shard_t &shard = this->shard(key);
+
+	pthread_mutex_lock(&shard.mutex);
+
+	bool found;
+	size_t bucket = find(shard, key, found);
+
+	if (found) {
+		size_t entry = shard.buckets[bucket] - 1;
+
+		__MEMCPY(temperature, &shard.values[entry * processor_count],
+			processor_count);
+
+		shard.used[entry] = 1;
+		shard.hits++;
+	}
+	else shard.misses++;
+
+	pthread_mutex_unlock(&shard.mutex);
+
+	return found;
+}
+
+void SlotCache::remember(const key_t &key, const double *temperature)
+{
+	if (capacity == 0) return;
+
+	shard_t &shard = this->shard(key);
+
+	pthread_mutex_lock(&shard.mutex);
+
+	bool found;
+	(void)find(shard, key, found);
+
+	/* Somebody else might have been faster */
+	if (found) {
+		pthread_mutex_unlock(&shard.mutex);
+		return;
+	}
+
+	size_t entry, count = shard.hashes.size();
+
+	if (count < capacity) {
+		entry = count++;
+
+		shard.hashes.push_back(0);
+		shard.keys.resize(count * key_size);
+		shard.values.resize(count * processor_count);
+		shard.used.push_back(0);
+
+		if (2 * count > shard.buckets.size())
+			rehash(shard, 2 * shard.buckets.size());
+	}
+	else {
+		/* Give the recently used ones another chance */
+		while (shard.used[shard.hand]) {
+			shard.used[shard.hand] = 0;
+			shard.hand = (shard.hand + 1) % count;
+		}
+
+		entry = shard.hand;
+		shard.hand = (shard.hand + 1) % count;
+
+		erase(shard, entry);
+		shard.evictions++;
+	}
+
+	shard.hashes[entry] = key.hash;
+	memcpy(&shard.keys[entry * key_size], &key.data[0], key_size);
+	__MEMCPY(&shard.values[entry * processor_count], temperature,
+		processor_count);
+	shard.used[entry] = 0;
+
+	insert(shard, entry);
+
+	pthread_mutex_unlock(&shard.mutex);
+}
+
+size_t SlotCache::size() const
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < SLOT_CACHE_SHARDS; i++)
+		size += shards[i].hashes.size();
+
+	return size;
+}
+
+size_t SlotCache::get_hits() const
+{
+	size_t hits = 0;
+
+	for (size_t i = 0; i < SLOT_CACHE_SHARDS; i++)
+		hits += shards[i].hits;
+
+	return hits;
+}
+
+size_t SlotCache::get_misses() const
+{
+	size_t misses = 0;
+
+	for (size_t i = 0; i < SLOT_CACHE_SHARDS; i++)
+		misses += shards[i].misses;
+
+	return misses;
+}
+
+size_t SlotCache::get_evictions() const
+{
+	size_t evictions = 0;
+
+	for (size_t i = 0; i < SLOT_CACHE_SHARDS; i++)
+		evictions += shards[i].evictions;
+
+	return evictions;
+}
+
+size_t SlotCache::find(const shard_t &shard, const key_t &key,
+	bool &found) const
+{
+	const size_t mask = shard.buckets.size() - 1;
+	size_t bucket = key.hash & mask;
+
+	found = false;
+
+	while (shard.buckets[bucket]) {
+		size_t entry = shard.buckets[bucket] - 1;
+
+		if (shard.hashes[entry] == key.hash &&
+			!memcmp(&shard.keys[entry * key_size], &key.data[0], key_size)) {
+
+			found = true;
+			break;
+		}
+
+		bucket = (bucket + 1) & mask;
+	}
+
+	return bucket;
+}
+
+void SlotCache::insert(shard_t &shard, size_t entry)
+{
+	const size_t mask = shard.buckets.size() - 1;
+	size_t bucket = shard.hashes[entry] & mask;
+
+	while (shard.buckets[bucket]) bucket = (bucket + 1) & mask;
+
+	shard.buckets[bucket] = entry + 1;
+}
+
+void SlotCache::erase(shard_t &shard, size_t entry)
+{
+	const size_t mask = shard.buckets.size() - 1;
+	size_t bucket = shard.hashes[entry] & mask;
+
+	while (shard.buckets[bucket] != entry + 1) bucket = (bucket + 1) & mask;
+
+	/* Shift back the ones that would not be found through the hole */
+	size_t next = bucket;
+
+	while (true) {
+		next = (next + 1) & mask;
+
+		if (!shard.buckets[next]) break;
+
+		size_t home = shard.hashes[shard.buckets[next] - 1] & mask;
+
+		bool stays = bucket <= next ?
+			(bucket < home && home <= next) :
+			(bucket < home || home <= next);
+
+		if (stays) continue;
+
+		shard.buckets[bucket] = shard.buckets[next];
+		bucket = next;
+	}
+
+	shard.buckets[bucket] = 0;
+}
+
+void SlotCache::rehash(shard_t &shard, size_t bucket_count)
+{
+	shard.buckets.assign(bucket_count, 0);
+
+	size_t count = shard.hashes.size();
+
+	/* NOTE: the last entry is not in place yet */
+	for (size_t i = 0; i + 1 < count; i++) insert(shard, i);
+}
@@ -0,0 +1,96 @@
+#ifndef __SLOT_CACHE_H__
+#define __SLOT_CACHE_H__
+
+#include "common.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define SLOT_CACHE_SHARDS 16
+
+typedef std::vector<int> SlotTrace;
+
+/* Keeps the steady-state temperatures of the slots, i.e., of the sets of
+ * the task types that run at the same time, in a flat hash table with
+ * open addressing. A trace is packed into a few bytes per processor,
+ * and the keys and the temperatures lie contiguously in arenas.
+ * The entries are spread over independently locked shards by the hash,
+ * and each shard, once at its part of the memory bound, evicts with
+ * the clock algorithm.
+ */
+class SlotCache
+{
+	public:
+
+	/* A packed trace with its hash, computed once for both recall
+	 * and remember.
+	 */
+	struct key_t
+	{
+		std::vector<unsigned char> data;
+		uint64_t hash;
+	};
+
+	/* NOTE: capacity is in bytes */
+	SlotCache(size_t _processor_count, size_t _type_count, size_t _capacity);
+	~SlotCache();
+
+	void pack(const SlotTrace &trace, key_t &key) const;
+
+	bool recall(const key_t &key, double *temperature);
+	void remember(const key_t &key, const double *temperature);
+
+	size_t size() const;
+
+	size_t get_hits() const;
+	size_t get_misses() const;
+	size_t get_evictions() const;
+
+	private:
+
+	struct shard_t
+	{
+		pthread_mutex_t mutex;
+
+		/* The entry of every bucket plus one, zero if the bucket is empty */
+		std::vector<uint32_t> buckets;
+
+		/* The entries */
+		std::vector<uint64_t> hashes;
+		std::vector<unsigned char> keys;
+		std::vector<double> values;
+		std::vector<unsigned char> used;
+
+		/* The clock */
+		size_t hand;
+
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+	};
+
+	const size_t processor_count;
+	const size_t width;
+	const size_t key_size;
+
+	/* The number of entries per shard */
+	size_t capacity;
+
+	shard_t shards[SLOT_CACHE_SHARDS];
+
+	SlotCache(const SlotCache &);
+
+	inline shard_t &shard(const key_t &key)
+	{
+		return shards[(key.hash >> 60) % SLOT_CACHE_SHARDS];
+	}
+
+	/* The bucket of the key or the empty one where it should go */
+	size_t find(const shard_t &shard, const key_t &key, bool &found) const;
+
+	void insert(shard_t &shard, size_t entry);
+	void erase(shard_t &shard, size_t entry);
+	void rehash(shard_t &shard, size_t bucket_count);
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "Architecture.h"
 #include "Graph.h"
 #include "Hotspot.h"
+#include "ModelCache.h"
 #include "Schedule.h"
 #include "Layout.h"
 #include "Priority.h"
@@ -26,6 +27,13 @@ class TestCase
 	Architecture *architecture;
 	BasicListScheduler *scheduler;
 	Leakage *leakage;
+
+	/* The depth of the Anderson acceleration of the leakage iterations */
+	size_t history;
+
+	/* The reduction of the model of the hotspot being optimized */
+	const reduction_t reduction;
+
 	Hotspot *hotspot;
 
 	mapping_t mapping;
@@ -44,10 +52,15 @@ class TestCase
 		solution_tuning(_solution_tuning),
 
 		graph(NULL), architecture(NULL), scheduler(NULL),
-		leakage(NULL), hotspot(NULL)
+		leakage(NULL), history(0),
+		reduction(_solution_tuning.reduction_order,
+			_solution_tuning.reduction_error),
+		hotspot(NULL)
 	{
 		system_t system(_system);
 
+		ModelCache::set_directory(solution_tuning.model_cache);
+
 		if (system_tuning.power_scale != 1) {
 			if (system_tuning.verbose)
 				std::cout << "Scaling the power consumption." << std::endl;
@@ -94,15 +107,29 @@ class TestCase
 		architecture = new ArchitectureBuilder(system.frequency,
 			system.voltage, system.ngate, system.nc, system.ceff);
 
+		/* Acceleration of the leakage iterations */
+		if (solution_tuning.acceleration == "anderson")
+			history = solution_tuning.acceleration_history;
+		else if (solution_tuning.accelerate())
+			throw std::runtime_error("The acceleration method is unknown.");
+
 		/* Leakage model */
 		if (solution_tuning.leakage == "linear") {
 			leakage = new LinearLeakage(architecture->get_processors());
 		}
 		else if (solution_tuning.leakage == "piecewise_linear") {
-			leakage = new PiecewiseLinearLeakage(architecture->get_processors());
+			leakage = new PiecewiseLinearLeakage(
+				architecture->get_processors());
 		}
 		else if (solution_tuning.leakage == "exponential") {
-			leakage = new ExponentialLeakage(architecture->get_processors());
+			leakage = new ExponentialLeakage(
+				architecture->get_processors(),
+				solution_tuning.leakage_precision);
+		}
+		else if (solution_tuning.leakage == "banded_linear") {
+			leakage = new BandedLinearLeakage(
+				architecture->get_processors(),
+				solution_tuning.leakage_bands);
 		}
 		else if (solution_tuning.leak())
 			throw std::runtime_error("The leakage model is unknown.");
@@ -147,7 +174,8 @@ class TestCase
 		else if (system_tuning.initialization == "temperature_criticality") {
 			TemperatureCriticalityPool::data_t data;
 			data.coefficient = system_tuning.criticality_coefficient;
-			data.hotspot = create_hotspot("precise_steady_state", true);
+			data.hotspot = create_hotspot("precise_steady_state",
+				reduction, true);
 
 			TemperatureCriticalityListScheduler another_scheduler(
 				*architecture, *graph);
@@ -211,7 +239,7 @@ class TestCase
 		Time::measure(&begin);
 #endif
 
-		hotspot = create_hotspot(solution_tuning.method);
+		hotspot = create_hotspot(solution_tuning.method, reduction);
 
 #ifdef MEASURE_TIME
 		Time::measure(&end);
@@ -228,28 +256,48 @@ class TestCase
 		__DELETE(hotspot);
 	}
 
-	Hotspot *create_hotspot(const std::string &method, bool one_step = false)
+	Hotspot *create_hotspot(const std::string &method,
+		const reduction_t &reduction, bool one_step = false)
 	{
 		/* Thermal model */
 		if (method == "condensed_equation") {
-			if (leakage)
+			const BandedLinearLeakage *banded =
+				dynamic_cast<const BandedLinearLeakage *>(leakage);
+
+			if (banded)
+				return new BandedCondensedEquationHotspot(
+					*architecture, *graph, floorplan_config, hotspot_config,
+					solution_tuning.hotspot, *banded, reduction);
+			else if (leakage)
 				return new LeakageCondensedEquationHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot, *leakage);
+					solution_tuning.hotspot, *leakage, history, reduction);
 			else
 				return new CondensedEquationHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot);
+					solution_tuning.hotspot, solution_tuning.threads,
+					reduction);
+		}
+		else if (method == "modal_condensed_equation") {
+			if (leakage)
+				return new LeakageModalCondensedEquationHotspot(
+					*architecture, *graph, floorplan_config, hotspot_config,
+					solution_tuning.hotspot, *leakage, history, reduction);
+			else
+				return new ModalCondensedEquationHotspot(
+					*architecture, *graph, floorplan_config, hotspot_config,
+					solution_tuning.hotspot, reduction);
 		}
 		else if (method == "fixed_condensed_equation") {
 			if (leakage)
 				return new LeakageFixedCondensedEquationHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot, *leakage);
+					solution_tuning.hotspot, *leakage, history, reduction);
 			else
 				return new FixedCondensedEquationHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot);
+					solution_tuning.hotspot, solution_tuning.threads,
+					reduction);
 		}
 		else if (method == "coarse_condensed_equation") {
 			if (leakage)
@@ -266,7 +314,16 @@ class TestCase
 			return new TransientAnalyticalHotspot(
 				*architecture, *graph, floorplan_config, hotspot_config,
 				solution_tuning.hotspot, solution_tuning.max_iterations,
-				solution_tuning.tolerance, solution_tuning.warmup);
+				solution_tuning.tolerance, solution_tuning.warmup, reduction);
+		}
+		else if (method == "krylov_grid") {
+			if (leakage)
+				throw std::runtime_error("Not implemented.");
+
+			return new KrylovGridHotspot(
+				*architecture, *graph, floorplan_config, hotspot_config,
+				solution_tuning.hotspot, solution_tuning.krylov_dimension,
+				solution_tuning.krylov_tolerance);
 		}
 		else if (method == "hotspot") {
 			if (leakage)
@@ -285,21 +342,24 @@ class TestCase
 			if (leakage)
 				return new LeakageSteadyStateHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot, *leakage);
+					solution_tuning.hotspot, *leakage, history,
+					solution_tuning.slot_cache_size << 20, reduction);
 			else
 				return new SteadyStateHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot);
+					solution_tuning.hotspot, solution_tuning.slot_cache_size << 20,
+					reduction);
 		}
 		else if (method == "precise_steady_state") {
 			if (leakage)
 				return new LeakagePreciseSteadyStateHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot, *leakage, one_step);
+					solution_tuning.hotspot, *leakage, history, one_step,
+					reduction);
 			else
 				return new PreciseSteadyStateHotspot(
 					*architecture, *graph, floorplan_config, hotspot_config,
-					solution_tuning.hotspot, one_step);
+					solution_tuning.hotspot, one_step, reduction);
 		}
 		else throw std::runtime_error("The solution method is unknown.");
 	}
@@ -0,0 +1,253 @@
+#include "ThermalModel.h"
+#include "ModelCache.h"
+
+#include <algorithm>
+
+ThermalModel::ThermalModel(
+	size_t _processor_count, size_t _node_count,
+	double _sampling_interval, double _ambient_temperature,
+	const double **conductivity, const double *capacitance,
+	size_t thread_count, const reduction_t &reduction) :
+
+	processor_count(_processor_count),
+	node_count(_node_count),
+	sampling_interval(_sampling_interval),
+	ambient_temperature(_ambient_temperature),
+	state_count(_node_count),
+	error_bound(0)
+{
+	size_t i, j;
+
+	K.resize(node_count, node_count);
+	sinvC.resize(node_count);
+
+	L.resize(node_count);
+	U.resize(node_count, node_count);
+	UT.resize(node_count, node_count);
+
+	G.resize(node_count, node_count);
+
+	for (i = 0; i < node_count; i++)
+		sinvC[i] = sqrt(1.0 / capacitance[i]);
+
+	ModelCache cache(node_count, processor_count, sampling_interval,
+		conductivity, capacitance);
+
+#ifdef MEASURE_TIME
+	decomposition_time = 0;
+#endif
+
+	if (cache.load(L, U, K, G))
+		transpose_matrix(U, UT);
+	else {
+		decompose(conductivity, thread_count);
+		cache.save(L, U, K, G);
+	}
+
+	KT.resize(node_count, node_count);
+	GT.resize(processor_count, node_count);
+
+	transpose_matrix(K, KT);
+
+	for (i = 0; i < processor_count; i++)
+		for (j = 0; j < node_count; j++)
+			GT[i][j] = G[j][i];
+
+	E.resize(node_count);
+	H.resize(node_count, processor_count);
+	HT.resize(processor_count, node_count);
+	W.resize(processor_count, node_count);
+
+	/* In the eigenbasis, the matrix exponent is diagonal:
+	 * K = U * diag(exp(t * l0), ...) * UT
+	 *
+	 * Hence, with Z = UT * Y, the recurrences decouple:
+	 * Z(i+1) = E * Z(i) + H * B(i)
+	 */
+	for (i = 0; i < node_count; i++)
+		E[i] = exp(sampling_interval * L[i]);
+
+	for (i = 0; i < node_count; i++)
+		for (j = 0; j < processor_count; j++)
+			HT[j][i] = H[i][j] = (E[i] - 1) / L[i] * UT[i][j] * sinvC[j];
+
+	for (i = 0; i < processor_count; i++)
+		for (j = 0; j < node_count; j++)
+			W[i][j] = sinvC[i] * U[i][j];
+
+	if (reduction.enabled()) reduce(reduction);
+}
+
+void ThermalModel::decompose(const double **conductivity,
+	size_t thread_count)
+{
+	size_t i, j;
+
+	matrix_t m_temp(node_count, node_count);
+	vector_t v_temp(node_count);
+
+	/* We have:
+	 * C * dT/dt = A * T + B
+	 */
+	matrix_t &A = K;
+
+	for (i = 0; i < node_count; i++)
+		for (j = 0; j < node_count; j++)
+			A[i][j] = -conductivity[i][j];
+
+	matrix_t &D = A;
+
+	/* We want to get rid of everything in front of dX/dt,
+	 * but at the same time we want to keep the matrix in front of X
+	 * symmetric, so we do the following substitution:
+	 * Y = C^(1/2) * T
+	 * D = C^(-1/2) * A * C^(-1/2)
+	 * E = C^(-1/2) * B
+	 *
+	 * Eventually, we have:
+	 * dY/dt = DY + E
+	 */
+	multiply_diagonal_matrix_matrix(sinvC, A, m_temp);
+	multiply_matrix_diagonal_matrix(m_temp, sinvC, D);
+
+#ifdef MEASURE_TIME
+	struct timespec begin, end;
+	Time::measure(&begin);
+#endif
+
+	/* Eigenvalue decomposition:
+	 * D = U * L * UT
+	 *
+	 * Where:
+	 * L = diag(l0, ..., l(n-1))
+	 */
+	EigenvalueDecomposition S(D, U, L, thread_count);
+
+#ifdef MEASURE_TIME
+	Time::measure(&end);
+	decomposition_time = Time::substract(&end, &begin);
+#endif
+
+	transpose_matrix(U, UT);
+
+	/* Matrix exponential:
+	 * K = exp(D * t) = U * exp(L * t) * UT
+	 */
+	for (i = 0; i < node_count; i++) v_temp[i] = exp(sampling_interval * L[i]);
+	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
+	multiply_matrix_matrix(m_temp, UT, K);
+
+	/* Coefficient matrix G:
+	 * G = D^(-1) * (exp(D * t) - I) * C^(-1/2) =
+	 * = U * diag((exp(t * l0) - 1) / l0, ...) * UT * C^(-1/2)
+	 */
+	for (i = 0; i < node_count; i++) v_temp[i] = (v_temp[i] - 1) / L[i];
+	multiply_matrix_diagonal_matrix(U, v_temp, m_temp);
+	multiply_matrix_matrix_diagonal_matrix(m_temp, UT, sinvC, G);
+}
+
+void ThermalModel::reduce(const reduction_t &reduction)
+{
+	size_t i, j, k, u;
+
+	/* The bound of the response of each mode and its contribution
+	 * to the temperature error at the worst processor.
+	 */
+	vector_t response(node_count);
+	std::vector<std::pair<double, size_t> > order(node_count);
+
+	for (k = 0; k < node_count; k++) {
+		double sum = 0, peak = 0;
+
+		for (u = 0; u < processor_count; u++)
+			sum += std::abs(UT[k][u] * sinvC[u]);
+
+		response[k] = sum / std::abs(L[k]);
+
+		for (j = 0; j < processor_count; j++)
+			peak = std::max(peak, std::abs(W[j][k]));
+
+		order[k] = std::pair<double, size_t>(peak * response[k], k);
+	}
+
+	std::sort(order.begin(), order.end());
+
+	std::vector<bool> dropped(node_count, false);
+	vector_t error(processor_count, 0);
+
+	size_t count = node_count;
+
+	for (i = 0; i < node_count && count > 1; i++) {
+		k = order[i].second;
+
+		if (reduction.order) {
+			if (count <= reduction.order) break;
+		}
+		else {
+			for (j = 0; j < processor_count; j++)
+				if (error[j] + std::abs(W[j][k]) * response[k] >
+					reduction.error) break;
+
+			if (j < processor_count) break;
+		}
+
+		for (j = 0; j < processor_count; j++)
+			error[j] += std::abs(W[j][k]) * response[k];
+
+		dropped[k] = true;
+		count--;
+	}
+
+	if (count == node_count) return;
+
+	state_count = count;
+
+	for (j = 0; j < processor_count; j++)
+		error_bound = std::max(error_bound, error[j]);
+
+	/* The kept modes in their original order */
+	vector_t _L(count), _E(count);
+	matrix_t _H(count, processor_count), _W(processor_count, count);
+
+	for (k = 0, i = 0; k < node_count; k++) {
+		if (dropped[k]) continue;
+
+		_L[i] = L[k];
+		_E[i] = E[k];
+
+		for (j = 0; j < processor_count; j++) {
+			_H[i][j] = H[k][j];
+			_W[j][i] = W[j][k];
+		}
+
+		i++;
+	}
+
+	L = _L;
+	E = _E;
+	H = _H;
+	W = _W;
+
+	HT.resize(processor_count, count);
+
+	for (i = 0; i < count; i++)
+		for (j = 0; j < processor_count; j++)
+			HT[j][i] = H[i][j];
+
+	/* With Z = UT * Y as the state, the recurrences are the same,
+	 * but K = E is diagonal, G = H, and U = UT = I.
+	 */
+	K.resize(count, count);
+	K.nullify();
+	for (i = 0; i < count; i++) K[i][i] = E[i];
+
+	KT = K;
+	G = H;
+	GT = HT;
+
+	U.resize(count, count);
+	U.nullify();
+	for (i = 0; i < count; i++) U[i][i] = 1;
+
+	UT = U;
+}
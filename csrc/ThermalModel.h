@@ -0,0 +1,144 @@
+#ifndef __THERMAL_MODEL_H__
+#define __THERMAL_MODEL_H__
+
+#include "common.h"
+
+#ifdef MEASURE_TIME
+#include "Helper.h"
+#endif
+
+/* The model order reduction: either at most order modes are kept, or
+ * as many modes are dropped as the error bound allows. Zeros disable
+ * the reduction.
+ */
+struct reduction_t
+{
+	size_t order;
+	double error;
+
+	reduction_t(size_t _order = 0, double _error = 0) :
+		order(_order), error(_error) {}
+
+	inline bool enabled() const
+	{
+		return order || error;
+	}
+};
+
+/* The thermal RC circuit prepared for the analytical solutions:
+ * the eigenvalue decomposition and everything derived from it that does
+ * not depend on the power. Nothing changes once it is built, hence,
+ * one model can be shared by all the threads solving with it.
+ */
+class ThermalModel
+{
+	public:
+
+#ifdef MEASURE_TIME
+	double decomposition_time;
+#endif
+
+	const size_t processor_count;
+	const size_t node_count;
+
+	const double sampling_interval;
+	const double ambient_temperature;
+
+	/* The dimension of the state: node_count for the full model or
+	 * the number of the kept modes for a reduced one, see reduce().
+	 */
+	size_t state_count;
+
+	/* The a-priori bound of the temperature error of the reduced model
+	 * per watt of the processor power, zero for the full model.
+	 */
+	double error_bound;
+
+	/* Matrix exponent.
+	 *
+	 * NOTE: for a reduced model, the state is in the eigenbasis, hence,
+	 * K is diagonal, and U and UT are the identity.
+	 */
+	matrix_t K;
+
+	vector_t sinvC;
+	matrix_t G;
+
+	/* Transposed K and G (only the processor columns, processor_count x
+	 * node_count), the products go along the rows of these.
+	 */
+	matrix_t KT;
+	matrix_t GT;
+
+	/* Eigenvector decomposition
+	 *
+	 * D = U * L * UT
+	 */
+	vector_t L;
+	matrix_t U;
+	matrix_t UT;
+
+	/* Diagonal of the matrix exponent in the eigenbasis:
+	 * E = exp(L * t)
+	 */
+	vector_t E;
+
+	/* Power to the eigenbasis (node_count x processor_count):
+	 * H = diag((exp(t * l0) - 1) / l0, ...) * UT * C^(-1/2)
+	 */
+	matrix_t H;
+
+	/* Transposed H (processor_count x node_count) */
+	matrix_t HT;
+
+	/* Eigenbasis to the processor temperature (processor_count x node_count):
+	 * W = C^(-1/2) * U
+	 */
+	matrix_t W;
+
+	ThermalModel(size_t _processor_count, size_t _node_count,
+		double _sampling_interval, double _ambient_temperature,
+		const double **conductivity, const double *capacitance,
+		size_t thread_count = 1,
+		const reduction_t &reduction = reduction_t());
+
+	inline bool reduced() const
+	{
+		return state_count < node_count;
+	}
+
+	/* T = C^(-1/2) * Y + T_amb for the processor nodes, or
+	 * T = W * Z + T_amb for a reduced model.
+	 */
+	inline void observe(const double *Y, double *temperature) const
+	{
+		if (reduced())
+			multiply_matrix_vector_plus_scalar(W, Y, ambient_temperature,
+				temperature);
+		else
+			for (size_t j = 0; j < processor_count; j++)
+				temperature[j] = Y[j] * sinvC[j] + ambient_temperature;
+	}
+
+	private:
+
+	/* Computes L, U, UT, K, and G from scratch */
+	void decompose(const double **conductivity, size_t thread_count);
+
+	/* Modal truncation. The modes are independent in the eigenbasis,
+	 * hence, the error of dropping a set of modes is their own response
+	 * projected to the processors. With B(i) bounded by one watt,
+	 * the periodic solution of the k-th mode is bounded by
+	 * sum |H(k, u)| / (1 - E(k)), and the temperature error by
+	 *
+	 * max sum |W(j, k)| * sum |UT(k, u) * C^(-1/2)(u)| / |l(k)|
+	 *      j  k                u
+	 *
+	 * for the dropped k. The modes with the smallest contribution are
+	 * dropped first, then K, G, U, UT, E, H, and W are replaced by
+	 * their counterparts in the eigenbasis of the kept modes.
+	 */
+	void reduce(const reduction_t &reduction);
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t _thread_count) :
+	thread_count(std::max(_thread_count, (size_t)1)), ranges(thread_count)
+{
+	for (size_t i = 0; i < thread_count; i++)
+		pthread_mutex_init(&ranges[i].mutex, NULL);
+}
+
+ThreadPool::~ThreadPool()
+{
+	for (size_t i = 0; i < thread_count; i++)
+		pthread_mutex_destroy(&ranges[i].mutex);
+}
+
+bool ThreadPool::run(Job &job, size_t count)
+{
+	size_t i;
+
+	const size_t worker_count = std::min(thread_count, count);
+
+	if (worker_count == 0) return true;
+
+	std::vector<worker_t> workers(worker_count);
+
+	for (i = 0; i < worker_count; i++) {
+		ranges[i].first = i * count / worker_count;
+		ranges[i].last = (i + 1) * count / worker_count;
+
+		workers[i].pool = this;
+		workers[i].job = &job;
+		workers[i].id = i;
+		workers[i].stopped = false;
+		workers[i].failed = false;
+	}
+
+	/* The idle workers look for something to steal only among
+	 * the active ones.
+	 */
+	for (; i < thread_count; i++)
+		ranges[i].first = ranges[i].last = 0;
+
+	std::vector<pthread_t> threads(worker_count);
+
+	size_t created;
+
+	for (created = 1; created < worker_count; created++)
+		if (pthread_create(&threads[created], NULL, work, &workers[created]))
+			break;
+
+	work(&workers[0]);
+
+	for (i = 1; i < created; i++)
+		pthread_join(threads[i], NULL);
+
+	bool stopped = false;
+
+	for (i = 0; i < worker_count; i++) {
+		if (workers[i].failed)
+			throw std::runtime_error(workers[i].error);
+		if (workers[i].stopped) stopped = true;
+	}
+
+	if (created < worker_count)
+		throw std::runtime_error("Cannot create a thread.");
+
+	return !stopped;
+}
+
+void *ThreadPool::work(void *argument)
+{
+	worker_t *worker = (worker_t *)argument;
+	ThreadPool *pool = worker->pool;
+
+	size_t item;
+
+	try {
+		while (pool->take(worker->id, item) ||
+			(pool->steal(worker->id) && pool->take(worker->id, item))) {
+
+			if (worker->job->stop()) {
+				worker->stopped = true;
+				break;
+			}
+
+			worker->job->process(item, worker->id);
+		}
+	}
+	catch (std::exception &e) {
+		worker->failed = true;
+		worker->error = e.what();
+	}
+
+	/* Leave nothing behind for the others once failed or stopped */
+	if (worker->failed || worker->stopped) {
+		range_t &range = pool->ranges[worker->id];
+		pthread_mutex_lock(&range.mutex);
+		range.first = range.last;
+		pthread_mutex_unlock(&range.mutex);
+	}
+
+	return NULL;
+}
+
+bool ThreadPool::take(size_t id, size_t &item)
+{
+	range_t &range = ranges[id];
+
+	pthread_mutex_lock(&range.mutex);
+
+	bool found = range.first < range.last;
+	if (found) item = range.first++;
+
+	pthread_mutex_unlock(&range.mutex);
+
+	return found;
+}
+
+bool ThreadPool::steal(size_t id)
+{
+	size_t i, victim;
+	size_t length;
+
+	/* Several tries since the victim might have been robbed
+	 * by somebody else in the meantime.
+	 */
+	while (true) {
+		victim = id;
+		length = 0;
+
+		/* The longest range at the moment of looking, it might
+		 * change before it is locked again below.
+		 */
+		for (i = 0; i < thread_count; i++) {
+			if (i == id) continue;
+
+			range_t &range = ranges[i];
+
+			pthread_mutex_lock(&range.mutex);
+			size_t current = range.first < range.last ?
+				range.last - range.first : 0;
+			pthread_mutex_unlock(&range.mutex);
+
+			if (current > length) {
+				victim = i;
+				length = current;
+			}
+		}
+
+		if (victim == id) return false;
+
+		range_t &range = ranges[victim];
+
+		size_t first, last;
+
+		pthread_mutex_lock(&range.mutex);
+
+		if (range.first < range.last) {
+			last = range.last;
+			first = range.last - (range.last - range.first + 1) / 2;
+			range.last = first;
+		}
+		else first = last = 0;
+
+		pthread_mutex_unlock(&range.mutex);
+
+		if (first < last) {
+			range_t &own = ranges[id];
+
+			pthread_mutex_lock(&own.mutex);
+			own.first = first;
+			own.last = last;
+			pthread_mutex_unlock(&own.mutex);
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include "common.h"
+
+#include <pthread.h>
+
+/* Runs the items [0, count) of a job on several threads. Every worker
+ * starts with an even contiguous range and takes the items from its front;
+ * once the range is exhausted, the worker steals the back half of
+ * the longest range of the others, hence, the items of different cost
+ * are balanced without a shared queue. The threads are spawned per run,
+ * and the calling thread is the worker number zero.
+ */
+class ThreadPool
+{
+	public:
+
+	class Job
+	{
+		public:
+
+		virtual ~Job() {}
+
+		/* Called exactly once for each item unless the job is stopped,
+		 * worker is in [0, size()) and identifies the caller, so that
+		 * the job can keep a workspace per worker.
+		 */
+		virtual void process(size_t item, size_t worker) = 0;
+
+		/* Checked before each item, the run is abandoned as soon as
+		 * it returns true.
+		 */
+		virtual bool stop() const
+		{
+			return false;
+		}
+	};
+
+	ThreadPool(size_t _thread_count);
+	~ThreadPool();
+
+	inline size_t size() const
+	{
+		return thread_count;
+	}
+
+	/* Returns false if the job was stopped before all the items
+	 * were processed. An exception in any of the workers is rethrown
+	 * by the caller after all the workers are done.
+	 */
+	bool run(Job &job, size_t count);
+
+	private:
+
+	const size_t thread_count;
+
+	struct range_t
+	{
+		pthread_mutex_t mutex;
+		size_t first;
+		size_t last;
+	};
+
+	struct worker_t
+	{
+		ThreadPool *pool;
+		Job *job;
+		size_t id;
+		bool stopped;
+		bool failed;
+		std::string error;
+	};
+
+	std::vector<range_t> ranges;
+
+	ThreadPool(const ThreadPool &);
+
+	static void *work(void *argument);
+
+	/* Takes the next item of the worker's own range */
+	bool take(size_t id, size_t &item);
+
+	/* Moves the back half of the longest foreign range to the worker */
+	bool steal(size_t id);
+};
+
+#endif
@@ -118,6 +118,28 @@ void SolutionTuning::setup(const parameters_t &params)
 			leakage = it->value;
 		else if (it->name == "assessment")
 			assessment = it->value;
+		else if (it->name == "threads")
+			threads = it->to_int();
+		else if (it->name == "model_cache")
+			model_cache = it->value;
+		else if (it->name == "slot_cache_size")
+			slot_cache_size = it->to_int();
+		else if (it->name == "acceleration")
+			acceleration = it->value;
+		else if (it->name == "acceleration_history")
+			acceleration_history = it->to_int();
+		else if (it->name == "leakage_precision")
+			leakage_precision = it->to_double();
+		else if (it->name == "leakage_bands")
+			leakage_bands = it->to_int();
+		else if (it->name == "krylov_dimension")
+			krylov_dimension = it->to_int();
+		else if (it->name == "krylov_tolerance")
+			krylov_tolerance = it->to_double();
+		else if (it->name == "reduction_order")
+			reduction_order = it->to_int();
+		else if (it->name == "reduction_error")
+			reduction_error = it->to_double();
 	}
 }
 
@@ -131,7 +153,18 @@ void SolutionTuning::display(std::ostream &o) const
 		<< "  Warm up:              " << warmup << std::endl
 		<< "  Hotspot:              " << hotspot << std::endl
 		<< "  Leakage:              " << leakage << std::endl
-		<< "  Assessment:           " << assessment << std::endl;
+		<< "  Assessment:           " << assessment << std::endl
+		<< "  Threads:              " << threads << std::endl
+		<< "  Model cache:          " << model_cache << std::endl
+		<< "  Slot cache size (MB): " << slot_cache_size << std::endl
+		<< "  Acceleration:         " << acceleration << std::endl
+		<< "  History:              " << acceleration_history << std::endl
+		<< "  Leakage precision:    " << leakage_precision << std::endl
+		<< "  Leakage bands:        " << leakage_bands << std::endl
+		<< "  Krylov dimension:     " << krylov_dimension << std::endl
+		<< "  Krylov tolerance:     " << krylov_tolerance << std::endl
+		<< "  Reduction order:      " << reduction_order << std::endl
+		<< "  Reduction error:      " << reduction_error << std::endl;
 }
 
 void OptimizationTuning::setup(const parameters_t &params)
@@ -147,8 +180,16 @@ void OptimizationTuning::setup(const parameters_t &params)
 			mapping = it->to_bool();
 		else if (it->name == "multiobjective")
 			multiobjective = it->to_bool();
+		else if (it->name == "evaluation_threads")
+			evaluation_threads = it->to_int();
+		else if (it->name == "checkpoint_interval")
+			checkpoint_interval = it->to_int();
 		else if (it->name == "cache")
 			cache = it->value;
+		else if (it->name == "cache_size")
+			cache_size = it->to_int();
+		else if (it->name == "store")
+			store = it->value;
 		else if (it->name == "dump")
 			dump = it->value;
 	}
@@ -163,7 +204,11 @@ void OptimizationTuning::display(std::ostream &o) const
 		<< "  Repeat:               " << repeat << std::endl
 		<< "  Consider mapping:     " << mapping << std::endl
 		<< "  Multi-objective:      " << multiobjective << std::endl
-		<< "  Cache server:         " << cache << std::endl
+		<< "  Evaluation threads:   " << evaluation_threads << std::endl
+		<< "  Checkpoint interval:  " << checkpoint_interval << std::endl
+		<< "  Cache:                " << cache << std::endl
+		<< "  Cache size (MB):      " << cache_size << std::endl
+		<< "  Fitness store:        " << store << std::endl
 		<< "  Dump evolution:       " << dump << std::endl;
 }
 
@@ -93,12 +93,32 @@ struct SolutionTuning: public Tuning
 	std::string hotspot;
 	std::string leakage;
 	std::string assessment;
+	size_t threads;
+	std::string model_cache;
+	size_t slot_cache_size;
+	std::string acceleration;
+	size_t acceleration_history;
+	double leakage_precision;
+	size_t leakage_bands;
+	size_t krylov_dimension;
+	double krylov_tolerance;
+	size_t reduction_order;
+	double reduction_error;
 
 	SolutionTuning() :
 		method("condensed_equation"),
 		max_iterations(100),
 		tolerance(0.1),
-		warmup(false) {}
+		warmup(false),
+		threads(1),
+		slot_cache_size(64),
+		acceleration_history(3),
+		leakage_precision(0),
+		leakage_bands(4),
+		krylov_dimension(50),
+		krylov_tolerance(1e-6),
+		reduction_order(0),
+		reduction_error(0) {}
 
 	void setup(const parameters_t &params);
 	void display(std::ostream &o) const;
@@ -112,6 +132,11 @@ struct SolutionTuning: public Tuning
 	{
 		return !assessment.empty();
 	}
+
+	inline bool accelerate() const
+	{
+		return !acceleration.empty();
+	}
 };
 
 struct OptimizationTuning: public Tuning
@@ -121,14 +146,33 @@ struct OptimizationTuning: public Tuning
 	bool mapping;
 	bool multiobjective;
 
+	/* The number of threads evaluating a population */
+	size_t evaluation_threads;
+
+	/* The number of the list scheduler steps between the checkpoints
+	 * the offspring are scheduled from, zero to always start over.
+	 */
+	size_t checkpoint_interval;
+
+	/* Either memory or a memcached server */
 	std::string cache;
+
+	/* The bound of the memory cache in megabytes */
+	size_t cache_size;
+
+	/* The directory of the fitness store kept between the runs */
+	std::string store;
+
 	std::string dump;
 
 	OptimizationTuning() :
 		seed(-1),
 		repeat(-1),
 		mapping(false),
-		multiobjective(false) {}
+		multiobjective(false),
+		evaluation_threads(1),
+		checkpoint_interval(0),
+		cache_size(64) {}
 
 	void setup(const parameters_t &params);
 	void display(std::ostream &o) const;
@@ -1,6 +1,120 @@
+#include <pthread.h>
+#include <algorithm>
+
 #include "matrix.h"
 #include "float.h"
 
+/* The kernels below are compiled for several instruction sets, and
+ * the best one is chosen at the first call according to CPUID.
+ * The vectors always go along the rows of the result, so every element
+ * is accumulated in the same order as with the plain scalar loops,
+ * and the results do not depend on the machine. For the same reason,
+ * the contraction into fused multiply-adds is disabled.
+ */
+#if defined(__GNUC__) && (__GNUC__ >= 6) && defined(__x86_64__) && \
+	!defined(WITHOUT_DISPATCH)
+#define __DISPATCH \
+	__attribute__((target_clones("avx512f", "avx2", "default"), \
+		optimize("fp-contract=off")))
+#else
+#define __DISPATCH
+#endif
+
+/* R (m x n) = M (m x l) * N (l x n) + A (m x n), where A can be NULL.
+ * Four rows of R are processed at once, so each row of N is loaded
+ * once per four rows of M.
+ */
+__DISPATCH
+static void gemm(size_t m, size_t n, size_t l,
+	const double *__restrict__ M, const double *__restrict__ N,
+	const double *__restrict__ A, double *__restrict__ R)
+{
+	size_t i, j, k;
+	double a0, a1, a2, a3;
+	const double *row;
+
+	for (i = 0; i + 4 <= m; i += 4, M += 4 * l, R += 4 * n) {
+		double *__restrict__ r0 = R;
+		double *__restrict__ r1 = R + n;
+		double *__restrict__ r2 = R + 2 * n;
+		double *__restrict__ r3 = R + 3 * n;
+
+		for (j = 0; j < n; j++) r0[j] = r1[j] = r2[j] = r3[j] = 0;
+
+		for (k = 0, row = N; k < l; k++, row += n) {
+			a0 = M[k];
+			a1 = M[l + k];
+			a2 = M[2 * l + k];
+			a3 = M[3 * l + k];
+
+			for (j = 0; j < n; j++) {
+				r0[j] += a0 * row[j];
+				r1[j] += a1 * row[j];
+				r2[j] += a2 * row[j];
+				r3[j] += a3 * row[j];
+			}
+		}
+
+		if (A) {
+			for (j = 0; j < 4 * n; j++) R[j] += A[j];
+			A += 4 * n;
+		}
+	}
+
+	for (; i < m; i++, M += l, R += n) {
+		for (j = 0; j < n; j++) R[j] = 0;
+
+		for (k = 0, row = N; k < l; k++, row += n) {
+			a0 = M[k];
+			for (j = 0; j < n; j++)
+				R[j] += a0 * row[j];
+		}
+
+		if (A) {
+			for (j = 0; j < n; j++) R[j] += A[j];
+			A += n;
+		}
+	}
+}
+
+/* R (n) = MT (m x n)^T * V (m) + A (n), where A can be NULL.
+ * This is a sequence of AXPY operations over the rows of MT, four
+ * of them per pass over R.
+ */
+__DISPATCH
+static void gemv_transposed(size_t m, size_t n,
+	const double *__restrict__ MT, const double *__restrict__ V,
+	const double *__restrict__ A, double *__restrict__ R)
+{
+	size_t i, j;
+	double v0, v1, v2, v3;
+
+	for (i = 0; i < n; i++) R[i] = 0;
+
+	for (j = 0; j + 4 <= m; j += 4, MT += 4 * n) {
+		v0 = V[j];
+		v1 = V[j + 1];
+		v2 = V[j + 2];
+		v3 = V[j + 3];
+
+		for (i = 0; i < n; i++) {
+			R[i] += v0 * MT[i];
+			R[i] += v1 * MT[n + i];
+			R[i] += v2 * MT[2 * n + i];
+			R[i] += v3 * MT[3 * n + i];
+		}
+	}
+
+	for (; j < m; j++, MT += n) {
+		v0 = V[j];
+		for (i = 0; i < n; i++)
+			R[i] += v0 * MT[i];
+	}
+
+	if (A)
+		for (i = 0; i < n; i++) R[i] += A[i];
+}
+
 void transpose_matrix(
 	const matrix_t &U, matrix_t &UT)
 {
@@ -34,44 +148,26 @@ void multiply_matrix_diagonal_matrix(
 void multiply_matrix_matrix(
 	const matrix_t &M, const matrix_t &N, matrix_t &R)
 {
-	int i, j, k;
-	int n = M.rows();
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < n; j++) {
-			R[i][j] = 0;
-			for (k = 0; k < n; k++)
-				R[i][j] += M[i][k] * N[k][j];
-		}
-	}
+	size_t n = M.rows();
+	gemm(n, n, n, M, N, NULL, R);
 }
 
 void multiply_matrix_matrix(
 	const matrix_t &M, const matrix_t &N, double *R)
 {
-	int i, j, k, l;
-	int n = M.rows();
-	for (i = 0, l = 0; i < n; i++) {
-		for (j = 0; j < n; j++, l++) {
-			R[l] = 0;
-			for (k = 0; k < n; k++)
-				R[l] += M[i][k] * N[k][j];
-		}
-	}
+	size_t n = M.rows();
+	gemm(n, n, n, M, N, NULL, R);
 }
 
 void multiply_matrix_matrix_diagonal_matrix(
 	const matrix_t &M, const matrix_t &N, const double *V, matrix_t &R)
 {
-	int i, j, k;
-	int n = M.rows();
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < n; j++) {
-			R[i][j] = 0;
-			for (k = 0; k < n; k++)
-				R[i][j] += M[i][k] * N[k][j];
+	size_t i, j;
+	size_t n = M.rows();
+	gemm(n, n, n, M, N, NULL, R);
+	for (i = 0; i < n; i++)
+		for (j = 0; j < n; j++)
 			R[i][j] *= V[j];
-		}
-	}
 }
 
 void multiply_matrix_incomplete_vector(
@@ -140,10 +236,325 @@ void multiply_matrix_vector(
 	}
 }
 
+void multiply_matrix_vector_plus_scalar(
+	const matrix_t &M, const double *V, double a, double *R)
+{
+	int i, j;
+	int n = M.rows();
+	int m = M.cols();
+	for (i = 0; i < n; i++) {
+		R[i] = 0;
+		for (j = 0; j < m; j++)
+			R[i] += M[i][j] * V[j];
+		R[i] += a;
+	}
+}
+
+void multiply_matrix_matrix_plus_matrix(size_t m, size_t n, size_t l,
+	const double *M, const double *N, const double *A, double *R)
+{
+	gemm(m, n, l, M, N, A, R);
+}
+
+void multiply_transposed_matrix_vector(
+	const matrix_t &MT, const double *V, double *R)
+{
+	gemv_transposed(MT.rows(), MT.cols(), MT, V, NULL, R);
+}
+
+void multiply_transposed_matrix_vector_plus_vector(
+	const matrix_t &MT, const double *V, const double *A, double *R)
+{
+	gemv_transposed(MT.rows(), MT.cols(), MT, V, A, R);
+}
+
+void multiply_sparse_matrix_vector(
+	const sparse_matrix_t &M, const double *V, double *R)
+{
+	size_t i, k;
+	size_t n = M.rows();
+
+	const size_t *offsets = &M._offsets[0];
+	const size_t *columns = &M._columns[0];
+	const double *values = &M._values[0];
+
+	for (i = 0; i < n; i++) {
+		double sum = 0;
+		for (k = offsets[i]; k < offsets[i + 1]; k++)
+			sum += values[k] * V[columns[k]];
+		R[i] = sum;
+	}
+}
+
+/* R (n) = MT (m x n, with the given stride)^T * V (m), the same as
+ * gemv_transposed but for a part of a bigger matrix.
+ */
+__DISPATCH
+static void gemv_strided(size_t m, size_t n, size_t stride,
+	const double *__restrict__ MT, const double *__restrict__ V,
+	double *__restrict__ R)
+{
+	size_t i, j;
+	double v0, v1, v2, v3;
+
+	for (i = 0; i < n; i++) R[i] = 0;
+
+	for (j = 0; j + 4 <= m; j += 4, MT += 4 * stride) {
+		v0 = V[j];
+		v1 = V[j + 1];
+		v2 = V[j + 2];
+		v3 = V[j + 3];
+
+		for (i = 0; i < n; i++) {
+			R[i] += v0 * MT[i];
+			R[i] += v1 * MT[stride + i];
+			R[i] += v2 * MT[2 * stride + i];
+			R[i] += v3 * MT[3 * stride + i];
+		}
+	}
+
+	for (; j < m; j++, MT += stride) {
+		v0 = V[j];
+		for (i = 0; i < n; i++)
+			R[i] += v0 * MT[i];
+	}
+}
+
+/* R (n) -= a * X (n) + b * Y (n) */
+__DISPATCH
+static void rank2_update(size_t n, double a, const double *__restrict__ X,
+	double b, const double *__restrict__ Y, double *__restrict__ R)
+{
+	for (size_t i = 0; i < n; i++)
+		R[i] -= (a * X[i] + b * Y[i]);
+}
+
+/* R (n) -= a * X (n) */
+__DISPATCH
+static void rank1_update(size_t n, double a, const double *__restrict__ X,
+	double *__restrict__ R)
+{
+	for (size_t i = 0; i < n; i++)
+		R[i] -= a * X[i];
+}
+
+/* Givens rotation of two rows */
+__DISPATCH
+static void rotate(size_t n, double s, double c,
+	double *__restrict__ X, double *__restrict__ Y)
+{
+	double f;
+
+	for (size_t i = 0; i < n; i++) {
+		f = Y[i];
+		Y[i] = s * X[i] + c * f;
+		X[i] = c * X[i] - s * f;
+	}
+}
+
+/* R (m x n) = M (m x l) * N (l x n), or R -= M * N, where all three
+ * can be parts of bigger matrices with the given lengths of the rows.
+ */
+__DISPATCH
+static void gemm_strided(size_t m, size_t n, size_t l,
+	const double *__restrict__ M, size_t ldm,
+	const double *__restrict__ N, size_t ldn,
+	double *__restrict__ R, size_t ldr, bool subtract)
+{
+	size_t i, j, k;
+	double a0, a1, a2, a3;
+	const double *row;
+	const double sign = subtract ? -1 : 1;
+
+	for (i = 0; i + 4 <= m; i += 4, M += 4 * ldm, R += 4 * ldr) {
+		double *__restrict__ r0 = R;
+		double *__restrict__ r1 = R + ldr;
+		double *__restrict__ r2 = R + 2 * ldr;
+		double *__restrict__ r3 = R + 3 * ldr;
+
+		if (!subtract)
+			for (j = 0; j < n; j++) r0[j] = r1[j] = r2[j] = r3[j] = 0;
+
+		for (k = 0, row = N; k < l; k++, row += ldn) {
+			a0 = sign * M[k];
+			a1 = sign * M[ldm + k];
+			a2 = sign * M[2 * ldm + k];
+			a3 = sign * M[3 * ldm + k];
+
+			for (j = 0; j < n; j++) {
+				r0[j] += a0 * row[j];
+				r1[j] += a1 * row[j];
+				r2[j] += a2 * row[j];
+				r3[j] += a3 * row[j];
+			}
+		}
+	}
+
+	for (; i < m; i++, M += ldm, R += ldr) {
+		if (!subtract)
+			for (j = 0; j < n; j++) R[j] = 0;
+
+		for (k = 0, row = N; k < l; k++, row += ldn) {
+			a0 = sign * M[k];
+			for (j = 0; j < n; j++)
+				R[j] += a0 * row[j];
+		}
+	}
+}
+
+/* The products with fewer multiplications are not worth a thread */
+#define PARALLEL_PRODUCT_WORK (1 << 18)
+
+struct product_t
+{
+	size_t m, n, l;
+	const double *M;
+	size_t ldm;
+	const double *N;
+	size_t ldn;
+	double *R;
+	size_t ldr;
+	bool subtract;
+};
+
+static void *compute_product(void *argument)
+{
+	const product_t &p = *(const product_t *)argument;
+	gemm_strided(p.m, p.n, p.l, p.M, p.ldm, p.N, p.ldn, p.R, p.ldr, p.subtract);
+	return NULL;
+}
+
+/* The same as gemm_strided split over the threads along the rows
+ * of the result, or along the columns when the rows are few.
+ */
+static void multiply(size_t thread_count, size_t m, size_t n, size_t l,
+	const double *M, size_t ldm, const double *N, size_t ldn,
+	double *R, size_t ldr, bool subtract = false)
+{
+	size_t i, first, last;
+
+	if ((double)m * (double)n * (double)l < PARALLEL_PRODUCT_WORK)
+		thread_count = 1;
+
+	const bool rows = m >= 4 * thread_count;
+	thread_count = std::min(thread_count, rows ? m : n);
+
+	if (thread_count <= 1) {
+		gemm_strided(m, n, l, M, ldm, N, ldn, R, ldr, subtract);
+		return;
+	}
+
+	std::vector<product_t> products(thread_count);
+	std::vector<pthread_t> threads(thread_count);
+	std::vector<bool> started(thread_count, false);
+
+	for (i = 0; i < thread_count; i++) {
+		product_t &p = products[i];
+
+		p.m = m;
+		p.n = n;
+		p.l = l;
+		p.M = M;
+		p.ldm = ldm;
+		p.N = N;
+		p.ldn = ldn;
+		p.R = R;
+		p.ldr = ldr;
+		p.subtract = subtract;
+
+		if (rows) {
+			first = i * m / thread_count;
+			last = (i + 1) * m / thread_count;
+			p.m = last - first;
+			p.M += first * ldm;
+			p.R += first * ldr;
+		}
+		else {
+			first = i * n / thread_count;
+			last = (i + 1) * n / thread_count;
+			p.n = last - first;
+			p.N += first;
+			p.R += first;
+		}
+	}
+
+	for (i = 1; i < thread_count; i++)
+		started[i] = !pthread_create(&threads[i], NULL,
+			compute_product, &products[i]);
+
+	compute_product(&products[0]);
+
+	/* Whatever could not get a thread is done here */
+	for (i = 1; i < thread_count; i++)
+		if (!started[i]) compute_product(&products[i]);
+
+	for (i = 1; i < thread_count; i++)
+		if (started[i]) pthread_join(threads[i], NULL);
+}
+
+/* The matrices up to this size go through the plain Householder
+ * reduction and QL iterations, and the same size is the leaf of
+ * the divide and conquer for the larger ones.
+ */
+#ifndef EIGEN_LEAF_SIZE
+#define EIGEN_LEAF_SIZE 25
+#endif
+
+/* The number of reflectors applied at once */
+#ifndef EIGEN_BLOCK_SIZE
+#define EIGEN_BLOCK_SIZE 32
+#endif
+
+EigenvalueDecomposition::EigenvalueDecomposition(const matrix_t &M,
+	matrix_t &U, vector_t &L, size_t _thread_count) :
+	n(M.rows()), thread_count(std::max(_thread_count, (size_t)1)),
+	z(U), d(L), e(n)
+{
+	z = M;
+
+	if (n <= EIGEN_LEAF_SIZE) {
+		tred2();
+		tqli();
+		eigsrt(d, z);
+		return;
+	}
+
+	const size_t size = n;
+	size_t i, j;
+
+	vector_t tau(size);
+	reduce(tau);
+
+	matrix_t V(size, size);
+	divide(size, d, e, V, thread_count);
+
+	/* The eigenvectors go to the columns in the descending order */
+	matrix_t X(size, size);
+	for (i = 0; i < size; i++)
+		for (j = 0; j < size; j++)
+			X[j][i] = V[size - 1 - i][j];
+
+	std::reverse(d.pointer(), d.pointer() + size);
+
+	transform(tau, X);
+
+	z = X;
+}
+
+/* The Householder reduction goes over the rows of the matrix only.
+ * For that, the whole active part of the matrix is kept symmetric,
+ * which gives exactly the same numbers as updating one triangle,
+ * since each mirrored element is computed from the same products
+ * just summed up the other way around.
+ */
 void EigenvalueDecomposition::tred2()
 {
 	int l,k,j,i;
 	double scale,hh,h,g,f;
+	vector_t w(n);
+	for (i=0;i<n;i++)
+		for (j=0;j<i;j++)
+			z[j][i]=z[i][j];
 	for (i=n-1;i>0;i--) {
 		l=i-1;
 		h=scale=0.0;
@@ -162,24 +573,19 @@ void EigenvalueDecomposition::tred2()
 				e[i]=scale*g;
 				h -= f*g;
 				z[i][l]=f-g;
+				/* e = A * u */
+				gemv_strided(i, i, n, z[0], z[i], e);
 				f=0.0;
 				for (j=0;j<i;j++) {
 					z[j][i]=z[i][j]/h;
-					g=0.0;
-					for (k=0;k<j+1;k++)
-						g += z[j][k]*z[i][k];
-					for (k=j+1;k<i;k++)
-						g += z[k][j]*z[i][k];
-					e[j]=g/h;
+					e[j]=e[j]/h;
 					f += e[j]*z[i][j];
 				}
 				hh=f/(h+h);
-				for (j=0;j<i;j++) {
-					f=z[i][j];
-					e[j]=g=e[j]-hh*f;
-					for (k=0;k<j+1;k++)
-						z[j][k] -= (f*e[k]+g*z[i][k]);
-				}
+				for (j=0;j<i;j++)
+					e[j]=e[j]-hh*z[i][j];
+				for (j=0;j<i;j++)
+					rank2_update(i, z[i][j], e, e[j], z[i], z[j]);
 			}
 		} else
 			e[i]=z[i][l];
@@ -187,28 +593,38 @@ void EigenvalueDecomposition::tred2()
 	}
 	d[0]=0.0;
 	e[0]=0.0;
-	for (i=0;i<n;i++) {
-		if (d[i] != 0.0) {
-			for (j=0;j<i;j++) {
-				g=0.0;
-				for (k=0;k<i;k++)
-					g += z[i][k]*z[k][j];
-				for (k=0;k<i;k++)
-					z[k][j] -= g*z[k][i];
-			}
+	/* NOTE: unsigned, so that the trip counts are plain to the compiler */
+	const size_t size = n;
+	for (size_t p=0;p<size;p++) {
+		if (d[p] != 0.0) {
+			/* w = Q^T * u */
+			gemv_strided(p, p, size, z[0], z[p], w);
+			for (size_t q=0;q<p;q++)
+				rank1_update(p, z[q][p], w, z[q]);
 		}
-		d[i]=z[i][i];
-		z[i][i]=1.0;
-		for (j=0;j<i;j++) z[j][i]=z[i][j]=0.0;
+		d[p]=z[p][p];
+		z[p][p]=1.0;
+		for (size_t q=0;q<p;q++) z[q][p]=z[p][q]=0.0;
 	}
 }
 
+/* The rotations are applied to the eigenvectors stored as rows,
+ * and transposed back in the end.
+ */
 void EigenvalueDecomposition::tqli()
 {
-	int m,l,iter,i,k;
-	double s,r,p,g,f,dd,c,b;
-	for (i=1;i<n;i++) e[i-1]=e[i];
+	matrix_t v(n, n);
+	transpose_matrix(z, v);
+	for (int i=1;i<n;i++) e[i-1]=e[i];
 	e[n-1]=0.0;
+	ql(n, d, e, v);
+	transpose_matrix(v, z);
+}
+
+void EigenvalueDecomposition::ql(int n, double *d, double *e, matrix_t &v)
+{
+	int m,l,iter,i;
+	double s,r,p,g,f,dd,c,b;
 	for (l=0;l<n;l++) {
 		iter=0;
 		do {
@@ -238,11 +654,7 @@ void EigenvalueDecomposition::tqli()
 					r=(d[i]-g)*s+2.0*c*b;
 					d[i+1]=g+(p=s*r);
 					g=c*r-b;
-					for (k=0;k<n;k++) {
-						f=z[k][i+1];
-						z[k][i+1]=s*z[k][i]+c*f;
-						z[k][i]=c*z[k][i]-s*f;
-					}
+					rotate(v.cols(), s, c, v[i], v[i+1]);
 				}
 				if (r == 0.0 && i >= l) continue;
 				d[l] -= p;
@@ -272,3 +684,631 @@ void EigenvalueDecomposition::eigsrt(vector_t &d, matrix_t &v) const
 		}
 	}
 }
+
+/* The blocked Householder reduction as in LAPACK: the reflectors of
+ * a panel are accumulated in V together with W, where the active part
+ * of the matrix is A - V * W^T - W * V^T, and the rest of the matrix is
+ * updated once per panel with a matrix product. The reflector k has
+ * the unit at k + 1, and it is stored in the row k of z from k + 2.
+ */
+void EigenvalueDecomposition::reduce(vector_t &tau)
+{
+	const size_t size = n;
+	size_t i, j, k, p, c, first, block, length;
+	double alpha, beta, norm, scale, gamma, x, y;
+
+	/* The rows of V and then W of the current panel */
+	matrix_t VW(2 * EIGEN_BLOCK_SIZE, size);
+	/* The columns of W and then V for the update */
+	vector_t WV(size * 2 * EIGEN_BLOCK_SIZE);
+	vector_t s(EIGEN_BLOCK_SIZE), t(EIGEN_BLOCK_SIZE);
+
+	tau[size - 1] = 0;
+	e[size - 1] = 0;
+
+	for (first = 0; first + 1 < size; first += block) {
+		block = std::min((size_t)EIGEN_BLOCK_SIZE, size - 1 - first);
+
+		for (j = 0; j < block; j++) {
+			k = first + j;
+
+			double *a = z[k];
+			double *v = VW[j];
+			double *w = VW[block + j];
+
+			/* Bring the row up to date with the panel */
+			for (p = 0; p < j; p++) {
+				const double *vp = VW[p], *wp = VW[block + p];
+				x = vp[k];
+				y = wp[k];
+				for (c = k; c < size; c++)
+					a[c] -= x * wp[c] + y * vp[c];
+			}
+
+			d[k] = a[k];
+
+			for (c = 0; c <= k; c++) v[c] = w[c] = 0;
+
+			alpha = a[k + 1];
+			length = size - k - 1;
+
+			norm = 0;
+			for (c = k + 2; c < size; c++) norm += a[c] * a[c];
+
+			if (norm == 0) {
+				tau[k] = 0;
+				e[k] = alpha;
+
+				v[k + 1] = 1;
+				for (c = k + 2; c < size; c++) v[c] = 0;
+				for (c = k + 1; c < size; c++) w[c] = 0;
+			}
+			else {
+				beta = -sign(sqrt(alpha * alpha + norm), alpha);
+				tau[k] = (beta - alpha) / beta;
+				e[k] = beta;
+
+				scale = 1.0 / (alpha - beta);
+				v[k + 1] = 1;
+				for (c = k + 2; c < size; c++) v[c] = a[c] * scale;
+
+				/* w = A * v, the active part is symmetric */
+				multiply(thread_count, 1, length, length, v + k + 1, size,
+					z[k + 1] + k + 1, size, w + k + 1, size);
+
+				/* w -= (V * W^T + W * V^T) * v */
+				for (p = 0; p < j; p++) {
+					const double *vp = VW[p], *wp = VW[block + p];
+					s[p] = t[p] = 0;
+					for (c = k + 1; c < size; c++) {
+						s[p] += wp[c] * v[c];
+						t[p] += vp[c] * v[c];
+					}
+				}
+
+				for (p = 0; p < j; p++) {
+					const double *vp = VW[p], *wp = VW[block + p];
+					for (c = k + 1; c < size; c++)
+						w[c] -= vp[c] * s[p] + wp[c] * t[p];
+				}
+
+				/* w = tau * w - tau / 2 * (tau * w^T * v) * v */
+				gamma = 0;
+				for (c = k + 1; c < size; c++) {
+					w[c] *= tau[k];
+					gamma += w[c] * v[c];
+				}
+
+				gamma *= -0.5 * tau[k];
+				for (c = k + 1; c < size; c++) w[c] += gamma * v[c];
+			}
+
+			for (c = k + 1; c < size; c++) a[c] = v[c];
+		}
+
+		/* A -= V * W^T + W * V^T for the rest of the matrix */
+		const size_t next = first + block;
+		length = size - next;
+
+		double *M = WV;
+		for (i = 0; i < length; i++, M += 2 * block)
+			for (p = 0; p < block; p++) {
+				M[p] = VW[block + p][next + i];
+				M[block + p] = VW[p][next + i];
+			}
+
+		multiply(thread_count, length, length, 2 * block, WV, 2 * block,
+			VW[0] + next, size, z[next] + next, size, true);
+	}
+
+	d[size - 1] = z[size - 1][size - 1];
+}
+
+/* The reflectors are applied in blocks from the last one as
+ * I - V * T * V^T, where T is upper triangular (LAPACK's dlarft).
+ */
+void EigenvalueDecomposition::transform(const vector_t &tau, matrix_t &X) const
+{
+	const size_t size = n;
+	const size_t count = size - 1;
+	size_t i, j, p, r, first, block, length;
+	double x;
+
+	matrix_t VT(EIGEN_BLOCK_SIZE, size);
+	vector_t V(size * EIGEN_BLOCK_SIZE);
+	matrix_t T(EIGEN_BLOCK_SIZE, EIGEN_BLOCK_SIZE);
+	matrix_t Y(EIGEN_BLOCK_SIZE, size), TY(EIGEN_BLOCK_SIZE, size);
+	vector_t dots(EIGEN_BLOCK_SIZE);
+
+	first = (count - 1) / EIGEN_BLOCK_SIZE * EIGEN_BLOCK_SIZE;
+
+	while (true) {
+		block = std::min((size_t)EIGEN_BLOCK_SIZE, count - first);
+		length = size - first - 1;
+
+		/* The reflectors from the row first + 1 of X */
+		for (j = 0; j < block; j++) {
+			double *v = VT[j];
+			const double *a = z[first + j];
+
+			for (r = 0; r < j; r++) v[r] = 0;
+			v[j] = 1;
+			for (r = j + 1; r < length; r++) v[r] = a[first + 1 + r];
+		}
+
+		for (r = 0; r < length; r++)
+			for (j = 0; j < block; j++)
+				V[r * block + j] = VT[j][r];
+
+		for (j = 0; j < block; j++) {
+			for (i = 0; i < j; i++) {
+				dots[i] = 0;
+				for (r = j; r < length; r++)
+					dots[i] += VT[i][r] * VT[j][r];
+			}
+
+			for (i = 0; i < j; i++) {
+				x = 0;
+				for (p = i; p < j; p++) x += T[i][p] * dots[p];
+				T[i][j] = -tau[first + j] * x;
+			}
+
+			T[j][j] = tau[first + j];
+		}
+
+		/* X -= V * (T * (V^T * X)) */
+		multiply(thread_count, block, size, length, VT, size,
+			X[first + 1], size, Y, size);
+
+		for (i = 0; i < block; i++) {
+			double *row = TY[i];
+			for (r = 0; r < size; r++) row[r] = 0;
+			for (p = i; p < block; p++) {
+				x = T[i][p];
+				const double *y = Y[p];
+				for (r = 0; r < size; r++) row[r] += x * y[r];
+			}
+		}
+
+		multiply(thread_count, length, size, block, V, block,
+			TY, size, X[first + 1], size, true);
+
+		if (first == 0) break;
+		first -= EIGEN_BLOCK_SIZE;
+	}
+}
+
+struct EigenvalueDecomposition::half_t
+{
+	size_t size;
+	double *d;
+	const double *e;
+	double *V;
+	size_t threads;
+	bool failed;
+};
+
+void *EigenvalueDecomposition::divide_half(void *argument)
+{
+	half_t &half = *(half_t *)argument;
+
+	try {
+		divide(half.size, half.d, half.e, half.V, half.threads);
+	}
+	catch (...) {
+		half.failed = true;
+	}
+
+	return NULL;
+}
+
+struct ascending_t
+{
+	const double *values;
+
+	ascending_t(const double *_values) : values(_values) {}
+
+	inline bool operator()(size_t i, size_t j) const
+	{
+		return values[i] < values[j];
+	}
+};
+
+/* Cuppen's divide and conquer: the tridiagonal matrix is split into two
+ * with a rank-one correction, and the eigenproblem of the diagonal plus
+ * the correction is solved via the secular equation.
+ */
+void EigenvalueDecomposition::divide(size_t size, double *d,
+	const double *e, double *V, size_t threads)
+{
+	size_t i;
+
+	if (size <= EIGEN_LEAF_SIZE) {
+		matrix_t v(size, size);
+		vector_t f(size);
+
+		v.nullify();
+		for (i = 0; i < size; i++) v[i][i] = 1;
+
+		for (i = 0; i + 1 < size; i++) f[i] = e[i];
+		f[size - 1] = 0;
+
+		ql(size, d, f, v);
+
+		std::vector<size_t> order(size);
+		for (i = 0; i < size; i++) order[i] = i;
+		std::sort(order.begin(), order.end(), ascending_t(d));
+
+		vector_t values(size);
+		for (i = 0; i < size; i++) {
+			values[i] = d[order[i]];
+			__MEMCPY(V + i * size, v[order[i]], size);
+		}
+		__MEMCPY(d, values, size);
+
+		return;
+	}
+
+	const size_t left = size / 2;
+	const size_t right = size - left;
+	const double beta = e[left - 1];
+
+	d[left - 1] -= abs(beta);
+	d[left] -= abs(beta);
+
+	vector_t VL(left * left), VR(right * right);
+
+	half_t half;
+	half.size = left;
+	half.d = d;
+	half.e = e;
+	half.V = VL;
+	half.threads = threads / 2;
+	half.failed = false;
+
+	pthread_t thread;
+	bool started = false;
+
+	if (threads > 1)
+		started = !pthread_create(&thread, NULL, divide_half, &half);
+
+	if (!started) {
+		half.threads = 1;
+		divide_half(&half);
+	}
+
+	try {
+		divide(right, d + left, e + left, VR,
+			started ? threads - threads / 2 : threads);
+	}
+	catch (...) {
+		half.failed = true;
+	}
+
+	if (started) pthread_join(thread, NULL);
+
+	if (half.failed)
+		throw std::runtime_error("The eigenvalue decomposition has failed.");
+
+	merge(size, left, beta, d, VL, VR, V, threads);
+}
+
+/* The eigenvalues and eigenvectors of diag(d) + rho * z * z^T, where
+ * the halves come from VL and VR. The components with small z and
+ * the pairs of close eigenvalues are deflated as in LAPACK's dlaed2,
+ * and the eigenvectors of the rest are computed with z recomputed from
+ * the roots (Gu and Eisenstat), so that they stay orthogonal.
+ */
+void EigenvalueDecomposition::merge(size_t size, size_t left, double beta,
+	double *d, const double *VL, const double *VR, double *V,
+	size_t threads)
+{
+	const size_t right = size - left;
+	size_t i, j, k, count;
+	double x, y, c, s, r, t, tolerance;
+
+	/* The eigenvectors of the halves as the rows in the whole space */
+	matrix_t G(size, size);
+	G.nullify();
+
+	for (i = 0; i < left; i++)
+		__MEMCPY(G[i], VL + i * left, left);
+
+	for (i = 0; i < right; i++)
+		__MEMCPY(G[left + i] + left, VR + i * right, right);
+
+	/* Which halves are nonzero in each row: 1 for the upper, 2 for the lower */
+	std::vector<unsigned char> mask(size);
+	for (i = 0; i < size; i++) mask[i] = i < left ? 1 : 2;
+
+	/* Normalize z to the unit length */
+	const double half = sqrt(0.5);
+	const double rho = 2 * abs(beta);
+
+	vector_t z(size);
+	for (i = 0; i < left; i++)
+		z[i] = VL[i * left + left - 1] * half;
+	for (i = 0; i < right; i++)
+		z[left + i] = (beta < 0 ? -1 : 1) * VR[i * right] * half;
+
+	std::vector<size_t> order(size);
+	for (i = 0; i < size; i++) order[i] = i;
+	std::sort(order.begin(), order.end(), ascending_t(d));
+
+	x = y = 0;
+	for (i = 0; i < size; i++) {
+		x = std::max(x, abs(d[i]));
+		y = std::max(y, abs(z[i]));
+	}
+
+	tolerance = 8 * DBL_EPSILON * std::max(x, y);
+
+	std::vector<size_t> kept, deflated;
+	size_t candidate = size;
+
+	for (k = 0; k < size; k++) {
+		j = order[k];
+
+		if (rho * abs(z[j]) <= tolerance) {
+			deflated.push_back(j);
+			continue;
+		}
+
+		if (candidate == size) {
+			candidate = j;
+			continue;
+		}
+
+		s = z[candidate];
+		c = z[j];
+		r = pythag(c, s);
+		t = d[j] - d[candidate];
+		c /= r;
+		s = -s / r;
+
+		if (abs(t * c * s) <= tolerance) {
+			/* Rotate the pair to zero one component of z */
+			z[j] = r;
+			z[candidate] = 0;
+
+			double *X = G[candidate], *Y = G[j];
+			for (i = 0; i < size; i++) {
+				x = X[i];
+				y = Y[i];
+				X[i] = c * x + s * y;
+				Y[i] = c * y - s * x;
+			}
+
+			mask[candidate] = mask[j] = mask[candidate] | mask[j];
+
+			x = d[candidate];
+			y = d[j];
+			d[candidate] = x * c * c + y * s * s;
+			d[j] = x * s * s + y * c * c;
+
+			deflated.push_back(candidate);
+		}
+		else kept.push_back(candidate);
+
+		candidate = j;
+	}
+
+	if (candidate != size) kept.push_back(candidate);
+
+	count = kept.size();
+
+	vector_t values(size);
+	matrix_t Q(count, size);
+
+	if (count) {
+		vector_t dk(count), zk(count), zh(count);
+
+		for (i = 0; i < count; i++) {
+			dk[i] = d[kept[i]];
+			zk[i] = z[kept[i]];
+		}
+
+		/* The row j of R is d(i) - lambda(j) */
+		matrix_t R(count, count);
+		for (j = 0; j < count; j++)
+			values[j] = secular(count, dk, zk, rho, j, R[j]);
+
+		for (i = 0; i < count; i++) {
+			x = R[i][i];
+			for (j = 0; j < count; j++)
+				if (j != i) x *= R[j][i] / (dk[i] - dk[j]);
+			x = sqrt(std::max(-x / rho, 0.0));
+			zh[i] = zk[i] < 0 ? -x : x;
+		}
+
+		for (j = 0; j < count; j++) {
+			double *q = R[j];
+
+			x = 0;
+			for (i = 0; i < count; i++) {
+				q[i] = zh[i] / q[i];
+				x += q[i] * q[i];
+			}
+
+			x = 1.0 / sqrt(x);
+			for (i = 0; i < count; i++) q[i] *= x;
+		}
+
+		/* Q = R * G for the upper and lower halves separately,
+		 * skipping the rows that are zero there.
+		 */
+		for (unsigned char part = 1; part <= 2; part++) {
+			const size_t offset = part == 1 ? 0 : left;
+			const size_t width = part == 1 ? left : right;
+
+			std::vector<size_t> rows;
+			for (i = 0; i < count; i++)
+				if (mask[kept[i]] & part) rows.push_back(i);
+
+			const size_t length = rows.size();
+
+			if (!length) {
+				for (j = 0; j < count; j++)
+					for (i = 0; i < width; i++) Q[j][offset + i] = 0;
+				continue;
+			}
+
+			vector_t A(count * length), B(length * width);
+
+			for (j = 0; j < count; j++)
+				for (k = 0; k < length; k++)
+					A[j * length + k] = R[j][rows[k]];
+
+			for (k = 0; k < length; k++)
+				__MEMCPY(B + k * width, G[kept[rows[k]]] + offset, width);
+
+			multiply(threads, count, width, length, A, length,
+				B, width, Q[0] + offset, size);
+		}
+	}
+
+	/* Everything together in the ascending order */
+	std::vector<const double *> vectors(size);
+
+	for (j = 0; j < count; j++) vectors[j] = Q[j];
+
+	for (k = 0; k < deflated.size(); k++) {
+		values[count + k] = d[deflated[k]];
+		vectors[count + k] = G[deflated[k]];
+	}
+
+	for (i = 0; i < size; i++) order[i] = i;
+	std::sort(order.begin(), order.end(), ascending_t(values));
+
+	for (i = 0; i < size; i++) {
+		d[i] = values[order[i]];
+		__MEMCPY(V + i * size, vectors[order[i]], size);
+	}
+}
+
+/* The rational approximation of both sides of the root with the two
+ * nearest poles (Bunch, Nielsen, and Sorensen), safeguarded with
+ * bisection. The distances are taken from the nearest pole to keep
+ * the accuracy of the small ones.
+ */
+double EigenvalueDecomposition::secular(size_t size, const double *d,
+	const double *z, double rho, size_t j, double *delta)
+{
+	size_t i, iteration, origin;
+	double lower, upper, tau, next, gap, f, x;
+	double psi, dpsi, phi, dphi, bound;
+
+	if (size == 1) {
+		delta[0] = -rho * z[0] * z[0];
+		return d[0] + rho * z[0] * z[0];
+	}
+
+	if (j + 1 < size) {
+		gap = d[j + 1] - d[j];
+
+		f = 1.0 / rho;
+		for (i = 0; i < size; i++)
+			f += z[i] * z[i] / ((d[i] - d[j]) - gap / 2);
+
+		if (f >= 0) {
+			origin = j;
+			lower = 0;
+			upper = gap / 2;
+		}
+		else {
+			origin = j + 1;
+			lower = -gap / 2;
+			upper = 0;
+		}
+	}
+	else {
+		origin = j;
+		lower = 0;
+		upper = 0;
+		for (i = 0; i < size; i++) upper += z[i] * z[i];
+		upper *= rho;
+		gap = 0;
+	}
+
+	for (i = 0; i < size; i++) delta[i] = d[i] - d[origin];
+
+	tau = (lower + upper) / 2;
+
+	for (iteration = 0; iteration < 100; iteration++) {
+		psi = dpsi = phi = dphi = 0;
+
+		for (i = 0; i <= j; i++) {
+			x = z[i] / (delta[i] - tau);
+			psi += z[i] * x;
+			dpsi += x * x;
+		}
+
+		for (; i < size; i++) {
+			x = z[i] / (delta[i] - tau);
+			phi += z[i] * x;
+			dphi += x * x;
+		}
+
+		f = 1.0 / rho + psi + phi;
+		bound = DBL_EPSILON * (8 * (1.0 / rho + phi - psi) +
+			abs(tau) * (dpsi + dphi));
+
+		if (abs(f) <= bound) break;
+
+		if (f < 0) lower = tau;
+		else upper = tau;
+
+		if (upper - lower <= 2 * DBL_EPSILON *
+			std::max(abs(lower), abs(upper))) break;
+
+		const double dj = delta[j] - tau;
+		const double a = psi - dj * dpsi;
+		const double p = dj * dj * dpsi;
+
+		next = lower - 1;
+
+		if (j + 1 < size) {
+			/* 1 / rho + a + p / dj' + b + q / dj1' = 0 for the new
+			 * dj' in (-gap, 0), where dj1' = dj' + gap.
+			 */
+			const double dj1 = delta[j + 1] - tau;
+			const double b = phi - dj1 * dphi;
+			const double q = dj1 * dj1 * dphi;
+			const double A = 1.0 / rho + a + b;
+			const double B = A * gap + p + q;
+			const double C = p * gap;
+
+			double root = 1;
+
+			if (A == 0) {
+				if (B != 0) root = -C / B;
+			}
+			else {
+				const double D = B * B - 4 * A * C;
+				if (D >= 0) {
+					const double h = -0.5 * (B + sign(sqrt(D), B));
+					const double r1 = h / A;
+					const double r2 = h != 0 ? C / h : 1;
+					if (r1 < 0 && r1 > -gap) root = r1;
+					else if (r2 < 0 && r2 > -gap) root = r2;
+				}
+			}
+
+			if (root < 0) next = tau + dj - root;
+		}
+		else {
+			/* 1 / rho + a + p / dj' = 0 */
+			const double A = 1.0 / rho + a + phi;
+			if (A > 0) next = tau + dj + p / A;
+		}
+
+		if (!(next > lower && next < upper)) next = (lower + upper) / 2;
+		if (next == tau) break;
+
+		tau = next;
+	}
+
+	for (i = 0; i < size; i++) delta[i] -= tau;
+
+	return d[origin] + tau;
+}
@@ -7,9 +7,21 @@
 #include <string.h>
 #include <math.h>
 #include <limits>
+#include <vector>
+
+/* The storage is aligned to the widest vector registers (AVX-512) */
+#define __ALIGNMENT 64
+
+inline double *__aligned_alloc(size_t size)
+{
+	void *data;
+	if (posix_memalign(&data, __ALIGNMENT, sizeof(double) * size))
+		return NULL;
+	return (double *)data;
+}
 
 #define __ALLOC(size) \
-	(double *)malloc(sizeof(double) * size)
+	__aligned_alloc(size)
 
 #define __FREE(some) \
 	do { \
@@ -226,6 +238,62 @@ struct matrix_t: public vector_t
 	}
 };
 
+/* Compressed sparse rows: the elements of the i-th row are kept
+ * in [_offsets[i], _offsets[i + 1]) of _columns and _values.
+ */
+struct sparse_matrix_t
+{
+	size_t _rows;
+	size_t _cols;
+
+	std::vector<size_t> _offsets;
+	std::vector<size_t> _columns;
+	std::vector<double> _values;
+
+	sparse_matrix_t() : _rows(0), _cols(0)
+	{
+	}
+
+	/* Drops all the elements, the rows are then filled in one by one
+	 * with append and closed with next_row.
+	 */
+	inline void resize(size_t __rows, size_t __cols)
+	{
+		_rows = __rows;
+		_cols = __cols;
+
+		_offsets.assign(1, 0);
+		_columns.clear();
+		_values.clear();
+	}
+
+	inline void append(size_t column, double value)
+	{
+		_columns.push_back(column);
+		_values.push_back(value);
+	}
+
+	inline void next_row()
+	{
+		_offsets.push_back(_columns.size());
+	}
+
+	inline size_t rows() const
+	{
+		return _rows;
+	}
+
+	inline size_t cols() const
+	{
+		return _cols;
+	}
+
+	inline size_t nonzeros() const
+	{
+		return _values.size();
+	}
+};
+
 void transpose_matrix(
 	const matrix_t &U, matrix_t &UT);
 void multiply_diagonal_matrix_matrix(
@@ -248,24 +316,39 @@ void multiply_matrix_matrix_vector(
 	const matrix_t &M, const matrix_t &N, const double *V, double *R);
 void multiply_matrix_vector(
 	const matrix_t &M, const double *V, double *R);
-
+void multiply_matrix_vector_plus_scalar(
+	const matrix_t &M, const double *V, double a, double *R);
+void multiply_matrix_matrix_plus_matrix(size_t m, size_t n, size_t l,
+	const double *M, const double *N, const double *A, double *R);
+void multiply_transposed_matrix_vector(
+	const matrix_t &MT, const double *V, double *R);
+void multiply_transposed_matrix_vector_plus_vector(
+	const matrix_t &MT, const double *V, const double *A, double *R);
+void multiply_sparse_matrix_vector(
+	const sparse_matrix_t &M, const double *V, double *R);
+
+/* The eigenvalues come in the descending order, and the eigenvectors
+ * are the columns of U. The small matrices go through the Householder
+ * reduction and QL iterations. The large ones are reduced to the
+ * tridiagonal form in blocks of reflectors, and the tridiagonal problem
+ * is solved by divide and conquer, which gives the eigenvectors already
+ * sorted. The products, the recursion, and the back-transformation
+ * run on several threads.
+ */
 class EigenvalueDecomposition
 {
 	const int n;
+	const size_t thread_count;
 
 	matrix_t &z;
 	vector_t &d, e;
 
+	struct half_t;
+
 	public:
 
-	EigenvalueDecomposition(const matrix_t &M, matrix_t &U, vector_t &L) :
-		n(M.rows()), z(U), d(L), e(n)
-	{
-		z = M;
-		tred2();
-		tqli();
-		eigsrt(d, z);
-	}
+	EigenvalueDecomposition(const matrix_t &M, matrix_t &U, vector_t &L,
+		size_t _thread_count = 1);
 
 	private:
 
@@ -273,22 +356,52 @@ class EigenvalueDecomposition
 	void tqli();
 	void eigsrt(vector_t &d, matrix_t &v) const;
 
-	inline double abs(const double &a) const
+	/* Leaves the diagonal in d, the off-diagonal in e, and
+	 * the reflectors in the rows of z.
+	 */
+	void reduce(vector_t &tau);
+
+	/* X = Q * X, where Q is the product of the reflectors */
+	void transform(const vector_t &tau, matrix_t &X) const;
+
+	/* The tridiagonal problem with the off-diagonal e[i] between i and
+	 * i + 1. The eigenvalues are written over d in the ascending order,
+	 * and the eigenvectors go to the rows of V.
+	 */
+	static void divide(size_t size, double *d, const double *e, double *V,
+		size_t threads);
+	static void *divide_half(void *argument);
+
+	static void merge(size_t size, size_t left, double beta, double *d,
+		const double *VL, const double *VR, double *V, size_t threads);
+
+	/* The root j of 1 / rho + sum z(i)^2 / (d(i) - x) = 0 with the distances
+	 * d(i) - x to all the poles.
+	 */
+	static double secular(size_t size, const double *d, const double *z,
+		double rho, size_t j, double *delta);
+
+	/* The implicit QL iterations with the rotations applied to the rows
+	 * of v, the off-diagonal e[i] is between i and i + 1.
+	 */
+	static void ql(int n, double *d, double *e, matrix_t &v);
+
+	static inline double abs(const double &a)
 	{
 		return a < 0 ? (-a) : a;
 	}
 
-	inline double sign(const double &a, const double &b) const
+	static inline double sign(const double &a, const double &b)
 	{
 		return (double)(b >= 0 ? (a >= 0 ? a : -a) : (a >= 0 ? -a : a));
 	}
 
-	inline double sqr(const double &a) const
+	static inline double sqr(const double &a)
 	{
 		return a * a;
 	}
 
-	inline double pythag(const double &a, const double &b) const
+	static inline double pythag(const double &a, const double &b)
 	{
 		double absa = abs(a), absb = abs(b);
 		return (absa > absb ? absa * sqrt(1.0 + sqr(absb / absa)) :
@@ -75,6 +75,56 @@ void backup(const string &iname, int index)
 	os << is.rdbuf();
 }
 
+/* Everything the prices depend on for the fitness store */
+string identify(const string &system, const string &floorplan,
+	const string &hotspot, const SystemTuning &system_tuning,
+	const SolutionTuning &solution_tuning, const TestCase &test)
+{
+	stringstream stream;
+
+	const string *files[] = { &system, &floorplan, &hotspot };
+
+	for (size_t i = 0; i < 3; i++) {
+		if (files[i]->empty()) continue;
+		ifstream file(files[i]->c_str(), ios::binary);
+		stream << file.rdbuf() << endl;
+
+		/* An empty file fails the stream */
+		stream.clear();
+	}
+
+	/* Only what changes the system or the solution, not the threads,
+	 * the caches, or the output. The real numbers go at full precision.
+	 */
+	stream << setprecision(17)
+		<< "Initialization: " << system_tuning.initialization << endl
+		<< "Urgency coefficient: " << system_tuning.criticality_coefficient << endl
+		<< "Deadline ratio: " << system_tuning.deadline_ratio << endl
+		<< "Maximal temperature: " << system_tuning.max_temperature << endl
+		<< "Task power scale: " << system_tuning.power_scale << endl
+		<< "Task time scale: " << system_tuning.time_scale << endl
+		<< "Homogeneous: " << system_tuning.homogeneous << endl
+		<< "Reorder tasks: " << system_tuning.reorder_tasks << endl
+		<< "Solution: " << solution_tuning.method << endl
+		<< "Max iterations: " << solution_tuning.max_iterations << endl
+		<< "Tolerance: " << solution_tuning.tolerance << endl
+		<< "Warm up: " << solution_tuning.warmup << endl
+		<< "Hotspot: " << solution_tuning.hotspot << endl
+		<< "Leakage: " << solution_tuning.leakage << endl
+		<< "Acceleration: " << solution_tuning.acceleration << endl
+		<< "History: " << solution_tuning.acceleration_history << endl
+		<< "Leakage precision: " << solution_tuning.leakage_precision << endl
+		<< "Leakage bands: " << solution_tuning.leakage_bands << endl
+		<< "Krylov dimension: " << solution_tuning.krylov_dimension << endl
+		<< "Krylov tolerance: " << solution_tuning.krylov_tolerance << endl
+		<< "Reduction order: " << solution_tuning.reduction_order << endl
+		<< "Reduction error: " << solution_tuning.reduction_error << endl
+		<< "Deadline: " << test.graph->get_deadline() << endl
+		<< "Sampling interval: " << test.hotspot->get_sampling_interval() << endl;
+
+	return stream.str();
+}
+
 void optimize(const string &system, const string &floorplan,
 	const string &hotspot, const string &_params,
 	stringstream &param_stream)
@@ -97,6 +147,7 @@ void optimize(const string &system, const string &floorplan,
 
 	BasicEvolution *evolution = NULL;
 	Evaluation *evaluation = NULL;
+	FitnessStore *store = NULL;
 
 	Hotspot *assessment_hotspot = NULL;
 	Evaluation *assessment_evaluation = NULL;
@@ -107,10 +158,34 @@ void optimize(const string &system, const string &floorplan,
 		/* Obtain the initial measurements to compare with.
 		 *
 		 */
-		if (optimization_tuning.cache.empty()) {
+		if (!optimization_tuning.store.empty()) {
+			if (!optimization_tuning.cache.empty() &&
+				optimization_tuning.cache != "memory")
+				throw runtime_error("The fitness store works with the memory cache only.");
+
+			store = new FitnessStore(optimization_tuning.store,
+				identify(system, floorplan, hotspot, system_tuning,
+					solution_tuning, test),
+				sizeof(step_t) * 2 * test.graph->size());
+
+			if (system_tuning.verbose)
+				cout << "Fitness store: " << store->get_filename()
+					<< " (" << store->size() << " entries, "
+					<< (store->writable() ? "read-write" : "read-only")
+					<< ")" << endl;
+		}
+
+		if (optimization_tuning.cache.empty() && !store) {
 			evaluation = new Evaluation(*test.architecture, *test.graph,
 				*test.hotspot, system_tuning.max_temperature);
 		}
+		else if (optimization_tuning.cache.empty() ||
+			optimization_tuning.cache == "memory") {
+			evaluation = new CachedEvaluation(optimization_tuning.cache.empty() ?
+				0 : optimization_tuning.cache_size << 20, store,
+				*test.architecture, *test.graph, *test.hotspot,
+				system_tuning.max_temperature);
+		}
 		else {
 #ifndef WITHOUT_MEMCACHED
 			evaluation = new MemcachedEvaluation(optimization_tuning.cache,
@@ -128,7 +203,9 @@ void optimize(const string &system, const string &floorplan,
 		price_t assessed_price, best_assessed_price;
 
 		if (solution_tuning.assess()) {
-			assessment_hotspot = test.create_hotspot(solution_tuning.assessment);
+			/* The assessment is the reference, hence, the full model */
+			assessment_hotspot = test.create_hotspot(solution_tuning.assessment,
+				reduction_t());
 			assessment_evaluation = new Evaluation(*test.architecture,
 				*test.graph, *assessment_hotspot, system_tuning.max_temperature);
 			assessed_price = assessment_evaluation->process(test.schedule);
@@ -156,7 +233,16 @@ void optimize(const string &system, const string &floorplan,
 			<< "Constrains: " << print_t<constrain_t>(constrains) << endl
 			<< endl
 			<< "Sampling interval: " << scientific << sampling_interval << endl
-			<< "Number of steps: " << fixed << step_count << endl
+			<< "Number of steps: " << fixed << step_count << endl;
+
+		if (test.hotspot->get_state_count() < test.hotspot->get_node_count())
+			cout
+				<< "Reduced model: " << test.hotspot->get_state_count()
+				<< " of " << test.hotspot->get_node_count() << " nodes, "
+				<< "error bound " << scientific
+				<< test.hotspot->get_error_bound() << fixed << " K/W" << endl;
+
+		cout
 			<< endl
 			<< "Initial lifetime: "
 			<< setiosflags(ios::fixed) << setprecision(2)
@@ -198,6 +284,24 @@ void optimize(const string &system, const string &floorplan,
 				<< stats << endl
 				<< *evaluation << endl;
 
+			const BasicSteadyStateHotspot *steady_state =
+				dynamic_cast<const BasicSteadyStateHotspot *>(test.hotspot);
+
+			if (steady_state) {
+				const SlotCache &cache = steady_state->get_cache();
+
+				size_t hits = cache.get_hits();
+				size_t lookups = hits + cache.get_misses();
+
+				cout
+					<< setiosflags(ios::fixed) << setprecision(0)
+					<< "Slot cache: " << cache.size() << " slots" << endl
+					<< "  Hits: " << hits
+						<< " (" << (lookups ? double(hits) / double(lookups) * 100 : 0)
+						<< "%)" << endl
+					<< "  Evictions: " << cache.get_evictions() << endl << endl;
+			}
+
 			cout << "Improvement: " << setiosflags(ios::fixed) << setprecision(3);
 
 			if (!optimization_tuning.multiobjective) {
@@ -252,6 +356,7 @@ void optimize(const string &system, const string &floorplan,
 	}
 	catch (exception &e) {
 		__DELETE(evaluation);
+		__DELETE(store);
 		__DELETE(evolution);
 		__DELETE(assessment_hotspot);
 		__DELETE(assessment_evaluation);
@@ -259,6 +364,7 @@ void optimize(const string &system, const string &floorplan,
 	}
 
 	__DELETE(evaluation);
+	__DELETE(store);
 	__DELETE(evolution);
 	__DELETE(assessment_hotspot);
 	__DELETE(assessment_evaluation);
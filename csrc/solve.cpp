@@ -116,8 +116,19 @@ void solve(const string &system, const string &floorplan,
 	OutputStream temperature_stream(_temperature, processor_count);
 	temperature_stream.write(temperature);
 
-	if (system_tuning.verbose)
+	if (system_tuning.verbose) {
 		cout << "Solved in " << Time::substract(&end, &begin) << " s" << endl;
+
+		if (solution_tuning.leak())
+			cout << "Leakage iterations: "
+				<< test.hotspot->get_iterations() << endl;
+
+		if (test.hotspot->get_state_count() < test.hotspot->get_node_count())
+			cout << "Reduced model: " << test.hotspot->get_state_count()
+				<< " of " << test.hotspot->get_node_count()
+				<< " nodes, error bound " << test.hotspot->get_error_bound()
+				<< " K/W" << endl;
+	}
 }
 
 int main(int argc, char **argv)